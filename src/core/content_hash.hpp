@@ -0,0 +1,52 @@
+#ifndef QMUJOCOSIM_CONTENT_HASH_HPP
+#define QMUJOCOSIM_CONTENT_HASH_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+
+/**
+ * 64-bit FNV-1a style hash for cache keys, consuming 8 bytes per step so that hashing meshes and textures stays
+ * well below the cost of compiling or uploading them. Not cryptographic; the result depends on byte order.
+ */
+struct ContentHash {
+    uint64_t value = 14695981039346656037ULL;
+    uint64_t length = 0;    // bytes added so far
+
+    void add(const void *data, size_t size) {
+        length += size;
+        auto bytes = static_cast<const unsigned char *>(data);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            mix(word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, bytes + i, size - i);
+        mix(tail ^ (static_cast<uint64_t>(size) << 56));
+    }
+
+    // strings include their length, so consecutive strings cannot run into each other
+    void add(const std::string &text) {
+        add(text.data(), text.size());
+    }
+
+    template<typename T>
+    void addArray(const T *data, long count) {
+        if (data != nullptr && count > 0) {
+            add(data, static_cast<size_t>(count) * sizeof(T));
+        } else {
+            mix(0);
+        }
+    }
+
+    void mix(uint64_t word) {
+        value = (value ^ word) * 1099511628211ULL;
+        value ^= value >> 29;
+    }
+};
+
+#endif //QMUJOCOSIM_CONTENT_HASH_HPP
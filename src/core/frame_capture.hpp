@@ -0,0 +1,135 @@
+#ifndef QMUJOCOSIM_FRAME_CAPTURE_HPP
+#define QMUJOCOSIM_FRAME_CAPTURE_HPP
+
+#include <atomic>
+#include <vector>
+#include <cmath>
+
+#include <mujoco/mujoco.h>
+
+#include "spsc_ring.hpp"
+
+
+/**
+ * Hands copies of `mjData` to a consumer thread at fixed intervals of simulation time, e.g. for video.
+ *
+ * The simulation thread calls `capture` after every step; whenever the simulation time crosses the next frame
+ * boundary the state is copied into a preallocated `mjData` and queued. The consumer `pop`s frames and gives the
+ * `mjData` back with `recycle`. Nothing is allocated or locked on the simulation thread: if the consumer falls
+ * behind and the pool runs dry, the frame is dropped and the next captured frame is repeated in its place, so
+ * the frame count (and therefore the video timing) stays right.
+ */
+class FrameCapture {
+public:
+    struct Frame {
+        mjData *data = nullptr;
+        long long index = 0;   // number of the first frame this data stands for
+        int repeat = 0;        // number of consecutive frames showing this data
+    };
+
+    FrameCapture() = default;
+
+    ~FrameCapture() {
+        stop();
+    }
+
+    FrameCapture(const FrameCapture &) = delete;
+
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    /**
+     * Allocate the pool and capture one frame per `interval` seconds of simulation time, starting with the next
+     * step. Neither side may be active.
+     */
+    void start(const mjModel *m, double interval, int poolSize = 32) {
+        stop();
+        interval_ = interval;
+        next_time_ = -1;
+        next_index_ = 0;
+        dropped_ = 0;
+        skipped_ = 0;
+
+        pool_.resize(poolSize);
+        queue_.resize(poolSize);
+        free_.resize(poolSize);
+        for (auto &data: pool_) {
+            data = mj_makeData(m);
+            free_.push(data);
+        }
+        active_ = true;
+    }
+
+    /**
+     * Free the pool. Neither side may be active; queued frames are discarded.
+     */
+    void stop() {
+        active_ = false;
+        for (auto &data: pool_) {
+            mj_deleteData(data);
+        }
+        pool_.clear();
+        queue_.resize(0);
+        free_.resize(0);
+    }
+
+    bool isActive() const {
+        return active_;
+    }
+
+    // producer side
+
+    void capture(const mjModel *m, const mjData *d) {
+        // first frame, or the simulation was reset or scrubbed back
+        if (next_time_ < 0 || d->time < next_time_ - interval_) {
+            next_time_ = d->time;
+        }
+        if (d->time < next_time_) {
+            return;
+        }
+
+        // frames whose boundary was crossed by this step
+        auto crossed = static_cast<long long>(std::floor((d->time - next_time_) / interval_)) + 1;
+        next_time_ += static_cast<double>(crossed) * interval_;
+
+        mjData *data = nullptr;
+        if (!free_.pop(data)) {
+            skipped_ += crossed;
+            dropped_ += crossed;
+            return;
+        }
+        mj_copyData(data, m, d);
+        Frame frame{data, next_index_, static_cast<int>(crossed + skipped_)};
+        next_index_ += frame.repeat;
+        skipped_ = 0;
+        queue_.push(frame);
+    }
+
+    // consumer side
+
+    bool pop(Frame &frame) {
+        return queue_.pop(frame);
+    }
+
+    void recycle(mjData *data) {
+        free_.push(data);
+    }
+
+    // frames that could not be copied because the consumer fell behind
+    long long dropped() const {
+        return dropped_;
+    }
+
+private:
+    std::vector<mjData *> pool_;
+    SpscRing<Frame> queue_;     // simulation thread -> consumer
+    SpscRing<mjData *> free_;   // consumer -> simulation thread
+
+    std::atomic_bool active_ = false;
+    double interval_ = 0;
+    double next_time_ = -1;   // simulation time of the next frame boundary
+    long long next_index_ = 0;
+    long long skipped_ = 0;   // frames to fold into the next captured one
+    std::atomic<long long> dropped_ = 0;
+};
+
+#endif //QMUJOCOSIM_FRAME_CAPTURE_HPP
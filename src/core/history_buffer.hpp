@@ -3,64 +3,258 @@
 
 
 #include <vector>
+#include <deque>
 #include <cstdint>
 #include <atomic>
 #include <cassert>
+#include <algorithm>
+#include <string>
+#include <ctime>
+#include <climits>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
 
 #include "mujoco/mujoco.h"
 
+#include "state_codec.hpp"
+#include "mapped_history_file.hpp"
+#include "spsc_ring.hpp"
+#include "trace_recorder.hpp"
+
+/**
+ * Compressed history of simulation states with tiered retention.
+ *
+ * Frames are stored in groups: the first frame of a group is a keyframe coded against zero, the following
+ * frames are coded against their predecessor (see `StateCodec`). Decoding a frame therefore never needs more
+ * than `kKeyframeInterval` frames.
+ *
+ * Older groups keep only their keyframe, and the oldest keyframes are thinned out further (see
+ * `keyframeSpacing`). Frames that are no longer stored are rebuilt by re-running `mj_step` from the nearest
+ * keyframe, so at most `kMaxResimulationSteps` steps are needed. Re-simulated frames are cached, so scrubbing
+ * back and forth within a gap only steps once. When the byte budget is exceeded anyway, the oldest groups are
+ * evicted.
+ *
+ * Alternatively (see `setBackingFile`) every frame is stored raw in a memory-mapped file, which holds hours of
+ * history for long sessions and can be analysed after the session.
+ *
+ * `addToHistory` only copies the state into a preallocated single-producer ring; a background recorder thread
+ * does the compression and indexing. Everything that reads the history drains the ring first.
+ *
+ * Frames are numbered consecutively; the scrub index is relative to the newest frame (0 is the newest,
+ * negative values go back in time) and is clamped to the oldest frame still stored.
+ */
 class HistoryBuffer {
 public:
-    explicit HistoryBuffer() {}
+    static constexpr int kKeyframeInterval = 32;
+    static constexpr int kDenseFrames = 4096;            // recent frames that are stored, not re-simulated
+    static constexpr int kMaxResimulationSteps = 1024;
+
+    static constexpr int kQueueLength = 256;
+
+    explicit HistoryBuffer() {
+        recorder_ = std::thread([this]() { recordLoop(); });
+    }
 
+    ~HistoryBuffer() {
+        {
+            std::lock_guard<std::mutex> lockGuard(store_mtx_);
+            stop_ = true;
+        }
+        store_cv_.notify_one();
+        recorder_.join();
+    }
+
+    /**
+     * Drop the history and store the state of `d` as its first frame.
+     * Like `addToHistory`, must not run concurrently with `addToHistory`.
+     */
     void initialize(mjModel *m, mjData *d) {
-        constexpr int kMaxHistoryBytes = static_cast<int>(1e8);
-        constexpr int maxHistoryLength = 2000;
+        constexpr size_t kMaxHistoryBytes = static_cast<size_t>(1e8);
+        constexpr size_t kMaxReplayBytes = static_cast<size_t>(1e7);
+        constexpr int maxHistoryLength = 1 << 22;
+
+        std::unique_lock<std::mutex> lock(store_mtx_);
 
         state_size_ = mj_stateSize(m, mjSTATE_INTEGRATION);
-        int state_bytes = state_size_ * static_cast<int>(sizeof(mjtNum));
-        int history_length = std::min(std::numeric_limits<int>::max() / state_bytes, maxHistoryLength);
-        int history_bytes = std::min(state_bytes * history_length, kMaxHistoryBytes);
-        nhistory_ = history_bytes / state_bytes;
-
-        // allocate history buffer, reset cursor and UI slider
-        history_.clear();
-        history_.resize(nhistory_ * state_size_);
-        history_cursor_ = 0;
-        scrub_index = 0;
+        queue_.resize(kQueueLength, state_size_ + 1);
+        pending_discontinuity_ = false;
+
+        max_bytes_ = kMaxHistoryBytes;
+        nhistory_ = maxHistoryLength;
 
-        // fill buffer with initial state
-        mj_getState(m, d, history_.data(), mjSTATE_INTEGRATION);
-        for (int i = 1; i < nhistory_; ++i) {
-            mju_copy(&history_[i * state_size_], history_.data(), state_size_);
+        file_.close();
+        if (file_bytes_ > 0) {
+            openBackingFile(m);
         }
+
+        // drop all frames, reset cursor and UI slider
+        groups_.clear();
+        spare_.clear();
+        bytes_ = 0;
+        newest_frame_ = -1;
+        decoded_frame_ = -1;
+        scrub_index = 0;
+
+        previous_.resize(state_size_);
+        decoded_.resize(state_size_);
+
+        replay_capacity_ = std::max(1, static_cast<int>(kMaxReplayBytes / (state_size_ * sizeof(mjtNum))));
+        replay_.clear();
+        replay_.reserve(static_cast<size_t>(replay_capacity_) * state_size_);
+        replay_first_ = -1;
+        replay_count_ = 0;
+
+        lock.unlock();
+
+        // store initial state
+        addToHistory(m, d);
     }
 
 
     void loadScrubState(mjModel *m, mjData *d) {
-        // get index into circular buffer
-        int i = (scrub_index + history_cursor_) % nhistory_;
-        i = (i + nhistory_) % nhistory_;
+        loadFrame(m, d, scrubFrame(scrub_index));
 
-        // load state
-        mjtNum *state = &history_[i * state_size_];
-        mj_setState(m, d, state, mjSTATE_INTEGRATION);
+        // whatever is recorded next does not follow the newest frame
+        markDiscontinuity();
+    }
+
+    /**
+     * Number of the frame `scrubIndex` refers to, clamped to the stored range.
+     * Frame numbers are never reused for the lifetime of a model, so they can be used as cache keys.
+     */
+    long long scrubFrame(int scrubIndex) {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        drain();
+
+        if (file_.isOpen()) {
+            long long newest = file_.count() - 1;
+            long long oldest = std::max(0ll, file_.count() - static_cast<long long>(file_.capacity()));
+            return std::clamp(newest + scrubIndex, oldest, newest);
+        }
+
+        if (groups_.empty()) {
+            return -1;
+        }
+        return std::clamp(newest_frame_ + scrubIndex, groups_.front().firstFrame, newest_frame_);
+    }
+
+    /**
+     * Load `frame` into `d` and call `mj_forward`. Unlike `loadScrubState` this does not touch the producer
+     * side, so it may run on any thread as long as `m` stays alive.
+     * @param cancelled polled while re-simulating; progress is kept in the replay cache
+     * @return false if the frame does not exist or loading was cancelled
+     */
+    bool loadFrame(mjModel *m, mjData *d, long long frame, const std::function<bool()> &cancelled = nullptr) {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        drain();
+
+        if (file_.isOpen()) {
+            long long oldest = std::max(0ll, file_.count() - static_cast<long long>(file_.capacity()));
+            if (frame < oldest || frame >= file_.count()) {
+                return false;
+            }
+            file_.read(frame, decoded_.data());
+            mj_setState(m, d, decoded_.data(), mjSTATE_INTEGRATION);
+            mj_forward(m, d);
+            return true;
+        }
+
+        if (groups_.empty() || frame < groups_.front().firstFrame || frame > newest_frame_) {
+            return false;
+        }
+
+        // load state, re-simulating if the frame is not stored
+        const HistoryGroup &group = findGroup(frame);
+        long long lastStored = group.firstFrame + static_cast<long long>(group.offsets.size()) - 1;
+        if (frame <= lastStored) {
+            decodeFrame(group, frame);
+            mj_setState(m, d, decoded_.data(), mjSTATE_INTEGRATION);
+        } else if (!resimulate(m, d, group, lastStored, frame, cancelled)) {
+            return false;
+        }
 
         // call forward dynamics
         mj_forward(m, d);
+        return true;
+    }
+
+    /**
+     * The next recorded frame does not follow from the newest one by `mj_step` (e.g. after a reset), so it
+     * starts a new group that is never merged into the previous one.
+     */
+    void markDiscontinuity() {
+        pending_discontinuity_ = true;
     }
 
+    /**
+     * Queue the state of `d` for recording. Called by a single producer (the thread holding the simulation lock).
+     */
     void addToHistory(mjModel *m, mjData *d) {
-        if (history_.empty()) {
+        TraceSpan span("addToHistory", "simulation");
+        if (state_size_ == 0) {
             return;
         }
 
-        // circular increment of cursor
-        history_cursor_ = (history_cursor_ + 1) % nhistory_;
+        mjtNum *entry = queue_.beginWrite();
+        if (entry == nullptr) {
+            // the recorder fell behind: record the oldest entry on this thread to make room
+            std::lock_guard<std::mutex> lockGuard(store_mtx_);
+            recordOne();
+            entry = queue_.beginWrite();
+        }
+
+        // entry layout: discontinuity flag, state
+        entry[0] = pending_discontinuity_ ? 1 : 0;
+        pending_discontinuity_ = false;
+        mj_getState(m, d, entry + 1, mjSTATE_INTEGRATION);
+        queue_.endWrite();
+
+        // pairs with the fence in `recordLoop`: either the recorder sees this entry, or this sees it idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (recorder_idle_.load(std::memory_order_relaxed)) {
+            // the recorder may be between checking the queue and blocking; it holds the mutex until it blocks
+            { std::lock_guard<std::mutex> lockGuard(store_mtx_); }
+            store_cv_.notify_one();
+        }
+    }
+
+    // record everything queued so far
+    void flush() {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        drain();
+    }
+
 
-        // add state at cursor
-        mjtNum *state = &history_[state_size_ * history_cursor_];
-        mj_getState(m, d, state, mjSTATE_INTEGRATION);
+    /**
+     * Store the history in a file of `maxBytes` bytes created in `directory` on the next `initialize`,
+     * or in memory if `maxBytes` is 0.
+     */
+    void setBackingFile(const std::string &directory, size_t maxBytes) {
+        file_directory_ = directory;
+        file_bytes_ = maxBytes;
+    }
+
+    // path of the current history file, empty if the history is kept in memory
+    std::string backingFilePath() const {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        return file_.isOpen() ? file_.path() : std::string();
+    }
+
+    /**
+     * Round the mantissa of subsequently recorded delta frames to `mantissaBits` bits (52 is lossless).
+     */
+    void setQuantization(int mantissaBits) {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        mantissa_bits_ = std::clamp(mantissaBits, 1, StateCodec::kLosslessMantissaBits);
+    }
+
+    int getQuantization() const {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        return mantissa_bits_;
     }
 
 
@@ -77,13 +271,327 @@ public:
         return nhistory_;
     }
 
+    // number of frames currently stored
+    int available() const {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        if (file_.isOpen()) {
+            return static_cast<int>(std::min<long long>(file_.count(), static_cast<long long>(file_.capacity())));
+        }
+        return groups_.empty() ? 0 : static_cast<int>(newest_frame_ - groups_.front().firstFrame + 1);
+    }
+
+    size_t memoryUsage() const {
+        std::lock_guard<std::mutex> lockGuard(store_mtx_);
+        return bytes_;
+    }
+
 private:
+    void recordLoop() {
+        std::unique_lock<std::mutex> lock(store_mtx_);
+        while (!stop_) {
+            drain();
+
+            // sleep until `addToHistory` or the destructor wakes it
+            recorder_idle_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            store_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            recorder_idle_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // consumer side of `queue_`; `store_mtx_` must be held
+    void drain() {
+        while (recordOne()) {}
+    }
+
+    bool recordOne() {
+        const mjtNum *entry = queue_.beginRead();
+        if (entry == nullptr) {
+            return false;
+        }
+        record(entry + 1, entry[0] != 0);
+        queue_.endRead();
+        return true;
+    }
+
+    // compress and index one frame; `store_mtx_` must be held
+    void record(const mjtNum *state, bool discontinuity) {
+        if (file_.isOpen()) {
+            file_.write(state);
+            return;
+        }
+
+        bool keyframe = groups_.empty() || groups_.back().offsets.size() >= kKeyframeInterval || discontinuity;
+        if (keyframe) {
+            groups_.push_back(makeGroup(newest_frame_ + 1));
+            groups_.back().continuous = !discontinuity && groups_.size() > 1;
+        }
+
+        HistoryGroup &group = groups_.back();
+        size_t capacity = group.bytes.capacity();
+        group.offsets.push_back(static_cast<uint32_t>(group.bytes.size()));
+
+        // keyframes are always lossless, so quantization error does not accumulate across groups
+        if (keyframe) {
+            StateCodec::encode(state, nullptr, state_size_, StateCodec::kLosslessMantissaBits,
+                               group.bytes, previous_.data());
+        } else {
+            StateCodec::encode(state, previous_.data(), state_size_, mantissa_bits_,
+                               group.bytes, previous_.data());
+        }
+        bytes_ += group.bytes.capacity() - capacity;
+        newest_frame_++;
+
+        if (keyframe) {
+            retain();
+        }
+
+        // demote (or else evict) the oldest groups until the byte budget is met
+        while (bytes_ > max_bytes_ && groups_.size() > 1) {
+            auto full = std::find_if(groups_.begin(), std::prev(groups_.end()),
+                                     [](const HistoryGroup &g) { return g.offsets.size() > 1; });
+            if (full != std::prev(groups_.end())) {
+                demote(*full);
+            } else {
+                evictOldestGroup();
+            }
+        }
+
+        // evict groups that are out of the scrub range
+        while (groups_.size() > 1 && newest_frame_ - groups_[1].firstFrame + 1 >= nhistory_) {
+            evictOldestGroup();
+        }
+    }
+
+    void openBackingFile(mjModel *m) {
+        char stamp[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(stamp, sizeof(stamp), "history_%Y_%m_%d_%H_%M_%S", std::localtime(&now));
+
+        // several loads, or several instances, within one second get numbered files; `open` never overwrites
+        for (int sequence = 0; sequence < 1000; sequence++) {
+            std::string name = std::string(stamp) + (sequence > 0 ? "_" + std::to_string(sequence) : "") + ".qmjh";
+            std::string path = (std::filesystem::path(file_directory_) / name).string();
+            if (file_.open(path, state_size_, mjSTATE_INTEGRATION, m->opt.timestep, file_bytes_)) {
+                nhistory_ = static_cast<int>(std::min<size_t>(file_.capacity(), INT_MAX));
+                std::cout << "History file: " << path << std::endl;
+                return;
+            }
+            std::error_code ec;
+            if (!std::filesystem::exists(path, ec)) {
+                return;   // failed for another reason, reported by `open`
+            }
+        }
+    }
+
+    struct HistoryGroup {
+        long long firstFrame = 0;
+        bool continuous = false;        // first frame follows the last frame of the previous group by `mj_step`
+        std::vector<uint32_t> offsets;  // byte offset of each stored frame in `bytes`
+        std::vector<uint8_t> bytes;
+    };
+
+    /**
+     * Maximum distance between consecutive keyframes for frames of the given age:
+     * dense recent keyframes, sparser older ones.
+     */
+    static long long keyframeSpacing(long long age) {
+        if (age < 8ll * kDenseFrames) {
+            return kKeyframeInterval;
+        } else if (age < 64ll * kDenseFrames) {
+            return kMaxResimulationSteps / 4;
+        }
+        return kMaxResimulationSteps;
+    }
+
+    // drop deltas of groups that left the dense window and thin out old keyframes; the newest group is kept as is
+    void retain() {
+        for (size_t i = 0; i + 1 < groups_.size(); i++) {
+            HistoryGroup &group = groups_[i];
+            if (group.offsets.size() > 1 && newest_frame_ - group.firstFrame >= kDenseFrames) {
+                demote(group);
+            }
+        }
+
+        for (size_t i = 1; i + 1 < groups_.size();) {
+            HistoryGroup &previous = groups_[i - 1];
+            const HistoryGroup &group = groups_[i];
+            long long span = groups_[i + 1].firstFrame - previous.firstFrame;
+            if (group.continuous && previous.offsets.size() == 1 && group.offsets.size() == 1 &&
+                span <= keyframeSpacing(newest_frame_ - previous.firstFrame)) {
+                // the frames of `group` are now re-simulated from the keyframe of `previous`
+                bytes_ -= group.bytes.capacity();
+                groups_.erase(groups_.begin() + static_cast<long>(i));
+            } else {
+                i++;
+            }
+        }
+    }
+
+    // keep only the keyframe of `group`; its large buffer is recycled for the next group
+    void demote(HistoryGroup &group) {
+        if (decoded_frame_ > group.firstFrame &&
+            decoded_frame_ < group.firstFrame + static_cast<long long>(group.offsets.size())) {
+            decoded_frame_ = -1;
+        }
+
+        HistoryGroup spare;
+        spare.bytes.swap(group.bytes);
+        group.bytes.assign(spare.bytes.begin(), spare.bytes.begin() + group.offsets[1]);
+        group.offsets.resize(1);
+        bytes_ += group.bytes.capacity();
+
+        recycle(std::move(spare));
+    }
+
+    // reuse the allocations of evicted groups, so recording does not allocate in the steady state
+    HistoryGroup makeGroup(long long firstFrame) {
+        HistoryGroup group;
+        if (!spare_.empty()) {
+            group = std::move(spare_.back());
+            spare_.pop_back();
+            bytes_ -= group.bytes.capacity();
+        }
+        group.firstFrame = firstFrame;
+        group.offsets.clear();
+        group.offsets.reserve(kKeyframeInterval);
+        group.bytes.clear();
+        bytes_ += group.bytes.capacity();
+        return group;
+    }
+
+    void evictOldestGroup() {
+        HistoryGroup &group = groups_.front();
+        if (decoded_frame_ >= group.firstFrame &&
+            decoded_frame_ < group.firstFrame + static_cast<long long>(group.offsets.size())) {
+            decoded_frame_ = -1;
+        }
+        recycle(std::move(group));
+        groups_.pop_front();
+    }
+
+    void recycle(HistoryGroup &&group) {
+        spare_.push_back(std::move(group));
+
+        // keep a single spare group, the largest; release the rest
+        while (spare_.size() > 1) {
+            auto smallest = std::min_element(spare_.begin(), spare_.end(), [](const auto &a, const auto &b) {
+                return a.bytes.capacity() < b.bytes.capacity();
+            });
+            bytes_ -= smallest->bytes.capacity();
+            spare_.erase(smallest);
+        }
+    }
+
+    const HistoryGroup &findGroup(long long frame) const {
+        auto it = std::upper_bound(groups_.begin(), groups_.end(), frame,
+                                   [](long long f, const HistoryGroup &g) { return f < g.firstFrame; });
+        assert(it != groups_.begin());
+        return *std::prev(it);
+    }
+
+    // decode stored `frame` of `group` into `decoded_`, continuing from the previously decoded frame when possible
+    void decodeFrame(const HistoryGroup &group, long long frame) {
+        int target = static_cast<int>(frame - group.firstFrame);
+        int k = 0;
+        if (decoded_frame_ >= group.firstFrame && decoded_frame_ <= frame) {
+            k = static_cast<int>(decoded_frame_ - group.firstFrame) + 1;
+        } else {
+            StateCodec::decode(group.bytes.data(), nullptr, state_size_, decoded_.data());
+            k = 1;
+        }
+        for (; k <= target; k++) {
+            StateCodec::decode(group.bytes.data() + group.offsets[k], decoded_.data(), state_size_,
+                               decoded_.data());
+        }
+        decoded_frame_ = frame;
+    }
+
+    /**
+     * Rebuild `frame` in `d` by stepping from the last stored frame of its group, or from the newest cached
+     * frame of the same group if that is closer. Frame numbers are never reused, so cached frames stay valid.
+     */
+    bool resimulate(mjModel *m, mjData *d, const HistoryGroup &group, long long lastStored, long long frame,
+                    const std::function<bool()> &cancelled) {
+        constexpr int kCancelCheckInterval = 16;
+
+        long long replayLast = replay_first_ + replay_count_ - 1;
+        if (replay_count_ > 0 && frame >= replay_first_ && frame <= replayLast) {
+            mj_setState(m, d, replayState(frame), mjSTATE_INTEGRATION);
+            return true;
+        }
+
+        long long start;
+        if (replay_count_ > 0 && replayLast > lastStored && replayLast < frame) {
+            start = replayLast;
+            mj_setState(m, d, replayState(replayLast), mjSTATE_INTEGRATION);
+        } else {
+            start = lastStored;
+            decodeFrame(group, lastStored);
+            mj_setState(m, d, decoded_.data(), mjSTATE_INTEGRATION);
+            replay_.clear();
+            replay_first_ = lastStored + 1;
+            replay_count_ = 0;
+        }
+
+        for (long long f = start + 1; f <= frame; f++) {
+            if (cancelled && (f - start) % kCancelCheckInterval == 0 && cancelled()) {
+                return false;
+            }
+
+            mj_step(m, d);
+
+            // keep the most recent half when the cache is full
+            if (replay_count_ == replay_capacity_) {
+                int keep = replay_capacity_ / 2;
+                std::copy(replay_.end() - static_cast<long>(keep) * state_size_, replay_.end(), replay_.begin());
+                replay_.resize(static_cast<size_t>(keep) * state_size_);
+                replay_first_ += replay_count_ - keep;
+                replay_count_ = keep;
+            }
+            replay_.resize(replay_.size() + state_size_);
+            mj_getState(m, d, replay_.data() + replay_.size() - state_size_, mjSTATE_INTEGRATION);
+            replay_count_++;
+        }
+        return true;
+    }
+
+    const mjtNum *replayState(long long frame) const {
+        return replay_.data() + static_cast<size_t>(frame - replay_first_) * state_size_;
+    }
+
+
+    std::deque<HistoryGroup> groups_;
+    std::vector<HistoryGroup> spare_;
+
+    std::vector<mjtNum> previous_;  // reconstruction of the newest frame, the reference for the next delta
+    std::vector<mjtNum> decoded_;   // last decoded frame
+    long long decoded_frame_ = -1;
+
+    std::vector<mjtNum> replay_;    // consecutive re-simulated frames, starting at `replay_first_`
+    long long replay_first_ = -1;
+    int replay_count_ = 0;
+    int replay_capacity_ = 0;
+
+    SpscRing<mjtNum> queue_;        // states waiting for the recorder, each prefixed by a discontinuity flag
+    bool pending_discontinuity_ = false;    // producer side
+
+    std::thread recorder_;
+    mutable std::mutex store_mtx_;  // guards everything the recorder touches
+    std::condition_variable store_cv_;
+    std::atomic_bool recorder_idle_ = false;
+    bool stop_ = false;
 
-    std::vector<mjtNum> history_;
+    std::string file_directory_;
+    size_t file_bytes_ = 0;
+    MappedHistoryFile file_;
 
-    int state_size_ = 0;      // number of mjtNums in a history buffer state
-    int nhistory_ = 0;        // number of states saved in history buffer
-    int history_cursor_ = 0;  // cursor pointing at last saved state
+    int state_size_ = 0;            // number of mjtNums in a history buffer state
+    int nhistory_ = 0;              // maximum number of frames that can be scrubbed
+    long long newest_frame_ = -1;   // number of the last saved frame
+    size_t bytes_ = 0;              // memory held by stored and spare groups
+    size_t max_bytes_ = 0;
+    int mantissa_bits_ = StateCodec::kLosslessMantissaBits;
 
     std::atomic_int scrub_index = 0;// index of history-scrubber slider
 };
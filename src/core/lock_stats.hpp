@@ -0,0 +1,192 @@
+#ifndef QMUJOCOSIM_LOCK_STATS_HPP
+#define QMUJOCOSIM_LOCK_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+
+/**
+ * Contention accounting for one mutex, per call site: how often each site took it, how long it waited for it
+ * and how long it held it, on average and at worst.
+ *
+ * Sites are a fixed list, so recording is a handful of relaxed atomic updates and never allocates. `TimedLock`
+ * does the timing; statistics can be read, exported and reset from any thread.
+ */
+class LockStats {
+public:
+    enum Site {
+        SIMULATION_LOOP,
+        STEP_FORWARD,
+        SCRUB,
+        ACCESS_MODEL_AND_DATA,
+        CLEAR_DATA_TIMERS,
+        IS_MODEL_DATA_NULL,
+        MOVE_CAMERA,
+        SET_PAUSED,
+        RESET,
+        REPLACE,
+        CONFIGURE,   // settings: threads, history, telemetry, capture, callbacks
+        FILE_IO,     // saving and printing the model or data
+        NSITE,
+    };
+
+    static constexpr const char *SITE_NAMES[NSITE] = {
+            "simulation loop",
+            "stepForward",
+            "scrub",
+            "accessModelAndData",
+            "clearDataTimers",
+            "isModelDataNull",
+            "moveCamera",
+            "setSimulationPaused",
+            "resetSimulation",
+            "replace/close",
+            "configure",
+            "save/print",
+    };
+
+    struct Summary {
+        const char *name = "";
+        uint64_t count = 0;
+        uint64_t contended = 0;   // acquisitions that found the mutex taken
+        double waitTotal = 0;     // seconds
+        double waitMax = 0;
+        double holdTotal = 0;
+        double holdMax = 0;
+    };
+
+    void record(Site site, double wait, double hold, bool contended) {
+        Counters &c = sites[site];
+        c.count.fetch_add(1, std::memory_order_relaxed);
+        if (contended) {
+            c.contended.fetch_add(1, std::memory_order_relaxed);
+        }
+        c.waitNanos.fetch_add(static_cast<uint64_t>(wait * 1e9), std::memory_order_relaxed);
+        c.holdNanos.fetch_add(static_cast<uint64_t>(hold * 1e9), std::memory_order_relaxed);
+        raise(c.waitMax, wait);
+        raise(c.holdMax, hold);
+    }
+
+    Summary summary(Site site) const {
+        const Counters &c = sites[site];
+        Summary s;
+        s.name = SITE_NAMES[site];
+        s.count = c.count.load(std::memory_order_relaxed);
+        s.contended = c.contended.load(std::memory_order_relaxed);
+        s.waitTotal = static_cast<double>(c.waitNanos.load(std::memory_order_relaxed)) * 1e-9;
+        s.waitMax = c.waitMax.load(std::memory_order_relaxed);
+        s.holdTotal = static_cast<double>(c.holdNanos.load(std::memory_order_relaxed)) * 1e-9;
+        s.holdMax = c.holdMax.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // sites that took the mutex at least once
+    std::vector<Summary> summaries() const {
+        std::vector<Summary> result;
+        for (int i = 0; i < NSITE; i++) {
+            Summary s = summary(static_cast<Site>(i));
+            if (s.count > 0) {
+                result.push_back(s);
+            }
+        }
+        return result;
+    }
+
+    // not synchronized with `record`: an acquisition in flight may land half before, half after
+    void reset() {
+        for (auto &c: sites) {
+            c.count = 0;
+            c.contended = 0;
+            c.waitNanos = 0;
+            c.holdNanos = 0;
+            c.waitMax = 0;
+            c.holdMax = 0;
+        }
+    }
+
+    // one row per site, times in msec
+    bool exportCsv(const std::string &path) const {
+        std::ofstream file(path);
+        file << "site,count,contended,wait_total,wait_mean,wait_max,hold_total,hold_mean,hold_max\n";
+        for (const auto &s: summaries()) {
+            double n = static_cast<double>(s.count);
+            file << s.name << ',' << s.count << ',' << s.contended << ','
+                 << s.waitTotal * 1e3 << ',' << s.waitTotal * 1e3 / n << ',' << s.waitMax * 1e3 << ','
+                 << s.holdTotal * 1e3 << ',' << s.holdTotal * 1e3 / n << ',' << s.holdMax * 1e3 << '\n';
+        }
+        return static_cast<bool>(file);
+    }
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> contended = 0;
+        std::atomic<uint64_t> waitNanos = 0;
+        std::atomic<uint64_t> holdNanos = 0;
+        std::atomic<double> waitMax = 0;
+        std::atomic<double> holdMax = 0;
+    };
+
+    static void raise(std::atomic<double> &max, double value) {
+        double current = max.load(std::memory_order_relaxed);
+        while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    std::array<Counters, NSITE> sites;
+};
+
+
+/**
+ * `std::unique_lock` that reports its wait and hold time to a `LockStats` site when it is released.
+ */
+class TimedLock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimedLock(std::mutex &mtx, LockStats &stats, LockStats::Site site)
+            : lock(mtx, std::defer_lock), stats(stats), site(site) {
+        auto start = Clock::now();
+        if (!lock.try_lock()) {
+            contended = true;
+            lock.lock();
+        }
+        acquired = Clock::now();
+        wait = std::chrono::duration<double>(acquired - start).count();
+    }
+
+    ~TimedLock() {
+        double hold = std::chrono::duration<double>(Clock::now() - acquired).count();
+        lock.unlock();
+        stats.record(site, wait, hold, contended);
+    }
+
+    TimedLock(const TimedLock &) = delete;
+
+    TimedLock &operator=(const TimedLock &) = delete;
+
+    // for condition variables
+    std::unique_lock<std::mutex> &get() {
+        return lock;
+    }
+
+    // count the hold time from now, e.g. after a condition variable wait that released the mutex
+    void restartHold() {
+        acquired = Clock::now();
+    }
+
+private:
+    std::unique_lock<std::mutex> lock;
+    LockStats &stats;
+    LockStats::Site site;
+    bool contended = false;
+    double wait = 0;
+    Clock::time_point acquired;
+};
+
+#endif //QMUJOCOSIM_LOCK_STATS_HPP
@@ -0,0 +1,288 @@
+#ifndef QMUJOCOSIM_MAPPED_HISTORY_FILE_HPP
+#define QMUJOCOSIM_MAPPED_HISTORY_FILE_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#endif
+
+#include <mujoco/mujoco.h>
+
+
+/**
+ * Ring of raw states in a memory-mapped file.
+ *
+ * File layout (little endian), readable after the session, e.g. with numpy.memmap:
+ *   Header (kHeaderSize bytes), followed by `capacity` slots of `stateSize` float64 values.
+ *   Frame f lives in slot f % capacity; frames [max(0, count - capacity), count) are valid.
+ *
+ * A background thread pre-faults the pages ahead of the writer and starts write-back of the pages behind it,
+ * so `write` is a plain memcpy into resident memory and does not run into page faults or dirty-page throttling.
+ * Only available on Linux; elsewhere `open` fails and the history stays in memory.
+ */
+class MappedHistoryFile {
+public:
+    struct Header {
+        char magic[8];           // "QMJHIST1"
+        uint32_t headerSize;
+        uint32_t stateSize;      // mjtNums per frame
+        uint32_t stateSpec;      // mjtState bits passed to mj_getState
+        uint32_t reserved;
+        uint64_t capacity;       // number of slots
+        uint64_t count;          // number of frames written so far
+        double timestep;
+    };
+
+    static constexpr size_t kHeaderSize = 4096;
+    static constexpr size_t kPrefaultAhead = 4 << 20;   // bytes kept resident ahead of the writer
+
+    MappedHistoryFile() = default;
+
+    ~MappedHistoryFile() {
+        close();
+    }
+
+    MappedHistoryFile(const MappedHistoryFile &) = delete;
+
+    MappedHistoryFile &operator=(const MappedHistoryFile &) = delete;
+
+    /**
+     * Create `path` with room for as many frames as fit in `maxBytes`.
+     * @return false if that failed, also (without a message) if `path` already exists
+     */
+    bool open(const std::string &path, int stateSize, unsigned int stateSpec, double timestep, size_t maxBytes) {
+        close();
+
+        state_bytes_ = static_cast<size_t>(stateSize) * sizeof(mjtNum);
+        capacity_ = maxBytes > kHeaderSize ? (maxBytes - kHeaderSize) / state_bytes_ : 0;
+        if (capacity_ == 0) {
+            std::cout << "History file: " << maxBytes << " bytes cannot hold a single frame." << std::endl;
+            return false;
+        }
+        size_ = kHeaderSize + capacity_ * state_bytes_;
+
+#ifndef __linux__
+        (void) stateSpec;
+        (void) timestep;
+        std::cout << "History file: cannot map " << path << " on this platform, keeping the history in memory."
+                  << std::endl;
+        capacity_ = 0;
+        return false;
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd_ < 0) {
+            if (errno == EEXIST) {
+                return false;
+            }
+            std::cout << "History file: could not open " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (::ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+            std::cout << "History file: could not resize " << path << ": " << std::strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+
+        void *map = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) {
+            std::cout << "History file: could not map " << path << ": " << std::strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+        base_ = static_cast<uint8_t *>(map);
+
+        Header *header = this->header();
+        std::memcpy(header->magic, "QMJHIST1", 8);
+        header->headerSize = kHeaderSize;
+        header->stateSize = static_cast<uint32_t>(stateSize);
+        header->stateSpec = stateSpec;
+        header->reserved = 0;
+        header->capacity = capacity_;
+        header->count = 0;
+        header->timestep = timestep;
+
+        written_ = 0;
+        path_ = path;
+        stop_ = false;
+        pager_ = std::thread([this]() { page(); });
+        return true;
+#endif
+    }
+
+    void close() {
+        if (pager_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lockGuard(mtx);
+                stop_ = true;
+            }
+            cv.notify_one();
+            pager_.join();
+        }
+#ifdef __linux__
+        if (base_) {
+            ::msync(base_, size_, MS_ASYNC);
+            ::munmap(base_, size_);
+            base_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+#endif
+        capacity_ = 0;
+        written_ = 0;
+    }
+
+    bool isOpen() const {
+        return base_ != nullptr;
+    }
+
+    const std::string &path() const {
+        return path_;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    // number of frames written so far
+    long long count() const {
+        return written_.load(std::memory_order_acquire);
+    }
+
+    void write(const mjtNum *state) {
+        long long frame = written_.load(std::memory_order_relaxed);
+        std::memcpy(slot(frame), state, state_bytes_);
+
+        header()->count = static_cast<uint64_t>(frame + 1);
+        written_.store(frame + 1, std::memory_order_release);
+
+        // wake the pager once per page worth of frames
+        if ((frame + 1) * state_bytes_ / kPageSize != frame * state_bytes_ / kPageSize) {
+            cv.notify_one();
+        }
+    }
+
+    void read(long long frame, mjtNum *state) const {
+        std::memcpy(state, slot(frame), state_bytes_);
+    }
+
+private:
+    static constexpr size_t kPageSize = 4096;
+
+    Header *header() const {
+        return reinterpret_cast<Header *>(base_);
+    }
+
+    uint8_t *slot(long long frame) const {
+        return base_ + kHeaderSize + static_cast<size_t>(frame % static_cast<long long>(capacity_)) * state_bytes_;
+    }
+
+    // offset in the file of slot `frame % capacity`
+    size_t offsetOf(long long frame) const {
+        return kHeaderSize + static_cast<size_t>(frame % static_cast<long long>(capacity_)) * state_bytes_;
+    }
+
+    void page() {
+        size_t data = size_ - kHeaderSize;
+        size_t ahead = std::min(kPrefaultAhead, data);
+        long long flushed = 0;   // frames handed to write-back
+        size_t prefaulted = 0;   // bytes of the slot area made resident, counted without wrapping
+
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stop_) {
+            long long frame = written_.load(std::memory_order_acquire);
+            size_t position = static_cast<size_t>(frame) * state_bytes_;
+
+            // make the pages ahead of the writer resident
+            while (prefaulted < position + ahead) {
+                size_t begin = kHeaderSize + (prefaulted % data) / kPageSize * kPageSize;
+                size_t length = std::min<size_t>(kPageSize * 64, size_ - begin);
+                prefault(begin, length);
+                prefaulted += length;
+            }
+
+            // start write-back of everything that is complete
+            if (frame > flushed) {
+                writeBack(flushed, frame);
+                flushed = frame;
+            }
+
+            cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+    }
+
+    void prefault(size_t begin, size_t length) {
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+        if (::madvise(base_ + begin, length, MADV_POPULATE_WRITE) == 0) {
+            return;
+        }
+#endif
+        // read one byte per page, so at least the page cache lookup happens here and not on the writer's thread
+        for (size_t offset = 0; offset < length; offset += kPageSize) {
+            volatile const uint8_t *p = base_ + begin + offset;
+            (void) *p;
+        }
+    }
+
+    void writeBack(long long from, long long to) {
+        if (to - from >= static_cast<long long>(capacity_)) {
+            from = to - static_cast<long long>(capacity_);
+        }
+        size_t begin = offsetOf(from) / kPageSize * kPageSize;
+        size_t end = offsetOf(to);
+        if (end > begin) {
+            syncRange(begin, end - begin);
+        } else {
+            // wrapped around
+            syncRange(begin, size_ - begin);
+            syncRange(kHeaderSize, end - kHeaderSize);
+        }
+        syncRange(0, kPageSize);
+    }
+
+    void syncRange(size_t begin, size_t length) {
+        if (length == 0) {
+            return;
+        }
+#if defined(SYNC_FILE_RANGE_WRITE)
+        ::sync_file_range(fd_, static_cast<off_t>(begin), static_cast<off_t>(length), SYNC_FILE_RANGE_WRITE);
+#elif defined(__linux__)
+        ::msync(base_ + begin, length, MS_ASYNC);
+#else
+        (void) begin;
+#endif
+    }
+
+
+    int fd_ = -1;
+    uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    size_t state_bytes_ = 0;
+    size_t capacity_ = 0;
+    std::string path_;
+
+    std::atomic<long long> written_ = 0;
+
+    std::thread pager_;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stop_ = false;
+};
+
+#endif //QMUJOCOSIM_MAPPED_HISTORY_FILE_HPP
@@ -0,0 +1,308 @@
+#ifndef QMUJOCOSIM_MODEL_CACHE_HPP
+#define QMUJOCOSIM_MODEL_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <set>
+#include <regex>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#else
+
+#include <random>
+
+#endif
+
+#include <mujoco/mujoco.h>
+
+#include "content_hash.hpp"
+
+
+/**
+ * On-disk cache of compiled models, so that reopening an MJCF file skips parsing, mesh processing and convex
+ * hulls.
+ *
+ * Entries are `<key>.mjb` files, where the key hashes the MuJoCo version, the XML and its includes, and every asset
+ * file they reference, followed by the total size of those inputs: serving the wrong model takes a hash
+ * collision between inputs of exactly the same size. Any edit to one of them makes a new entry; the least
+ * recently used entries are deleted once the cache exceeds its size. Hits are handed to `mj_loadModel` as an
+ * `mjVFS` buffer, read through a memory-mapped file on Linux and with a plain read elsewhere. MuJoCo 3.1.2 copies
+ * VFS buffers, so mapping saves the read calls, not the copy.
+ */
+class ModelCache {
+public:
+    ModelCache(std::string directory, uintmax_t maxBytes)
+            : directory(std::move(directory)), maxBytes(maxBytes) {}
+
+    /**
+     * Load `xmlPath` from the cache, or compile it and add it.
+     * @param hit set to whether the model came from the cache
+     * @param keyOut set to the key of the inputs as they were read, see `computeKey`
+     * @return the model, or null with `error` set
+     */
+    mjModel *load(const std::string &xmlPath, std::string &error, bool *hit = nullptr, std::string *keyOut = nullptr) {
+        if (hit) {
+            *hit = false;
+        }
+
+        std::string key = computeKey(xmlPath);
+        if (keyOut) {
+            *keyOut = key;
+        }
+        std::filesystem::path entry = std::filesystem::path(directory) / (key + ".mjb");
+        if (!key.empty()) {
+            if (mjModel *model = loadEntry(entry)) {
+                std::error_code ec;
+                std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), ec);
+                if (hit) {
+                    *hit = true;
+                }
+                return model;
+            }
+        }
+
+        char buffer[1000] = "";
+        mjModel *model = mj_loadXML(xmlPath.c_str(), nullptr, buffer, sizeof(buffer));
+        if (model == nullptr) {
+            error = buffer;
+            return nullptr;
+        }
+        if (!key.empty()) {
+            store(model, entry);
+        }
+        return model;
+    }
+
+    /**
+     * Content hash of the model and the number of bytes hashed, as `<16 hex digits>-<16 hex digits>`; empty if a
+     * referenced file could not be read, in which case the model is not cached.
+     */
+    static std::string computeKey(const std::string &xmlPath) {
+        ContentHash hash;
+        hash.add(std::to_string(mj_version()));
+        hash.add(mj_versionString());
+
+        std::filesystem::path root = std::filesystem::absolute(xmlPath).parent_path();
+        std::set<std::string> visited;
+        if (!hashModelFile(std::filesystem::absolute(xmlPath), root, {root}, hash, visited)) {
+            return {};
+        }
+
+        char hex[34];
+        std::snprintf(hex, sizeof(hex), "%016llx-%016llx", static_cast<unsigned long long>(hash.value),
+                      static_cast<unsigned long long>(hash.length));
+        return hex;
+    }
+
+private:
+    static bool readFile(const std::filesystem::path &path, std::string &content) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        content = stream.str();
+        return true;
+    }
+
+    static bool hashFile(const std::filesystem::path &path, ContentHash &hash) {
+        std::string content;
+        if (!readFile(path, content)) {
+            return false;
+        }
+        hash.add(content.data(), content.size());
+        return true;
+    }
+
+    /**
+     * Hash an MJCF file and, recursively, its includes and assets. Asset names are resolved against every
+     * directory MuJoCo might use (model directory, meshdir, texturedir, assetdir); all candidates that exist are
+     * hashed, which is conservative but never misses a change. Included files inherit the directories of the
+     * files that include them.
+     */
+    static bool hashModelFile(const std::filesystem::path &path, const std::filesystem::path &root,
+                              std::vector<std::filesystem::path> directories, ContentHash &hash,
+                              std::set<std::string> &visited) {
+        if (!visited.insert(path.lexically_normal().string()).second) {
+            return true;
+        }
+        std::string xml;
+        if (!readFile(path, xml)) {
+            std::cout << "Model cache: could not read " << path << std::endl;
+            return false;
+        }
+        hash.add(path.filename().string());
+        hash.add(xml.data(), xml.size());
+
+        directories.push_back(path.parent_path());
+        static const std::regex compilerTag(R"(<compiler\b[^>]*>)");
+        static const std::regex directoryAttribute(R"(\b(meshdir|texturedir|assetdir)\s*=\s*["']([^"']*)["'])");
+        for (std::sregex_iterator tag(xml.begin(), xml.end(), compilerTag), end; tag != end; ++tag) {
+            std::string text = tag->str();
+            for (std::sregex_iterator it(text.begin(), text.end(), directoryAttribute); it != end; ++it) {
+                directories.push_back(root / (*it)[2].str());
+            }
+        }
+
+        static const std::regex fileAttribute(R"(\bfile\w*\s*=\s*["']([^"']*)["'])");
+        for (std::sregex_iterator it(xml.begin(), xml.end(), fileAttribute), end; it != end; ++it) {
+            std::string name = (*it)[1].str();
+            bool include = isIncludeAttribute(xml, static_cast<size_t>(it->position()));
+
+            std::vector<std::filesystem::path> candidates;
+            if (std::filesystem::path(name).is_absolute()) {
+                candidates.emplace_back(name);
+            } else {
+                for (const auto &directory: directories) {
+                    candidates.push_back(directory / name);
+                }
+            }
+
+            bool found = false;
+            for (const auto &candidate: candidates) {
+                std::error_code ec;
+                if (!std::filesystem::is_regular_file(candidate, ec)) {
+                    continue;
+                }
+                found = true;
+                hash.add(name);
+                bool ok = include ? hashModelFile(candidate, root, directories, hash, visited) : hashFile(candidate, hash);
+                if (!ok) {
+                    return false;
+                }
+            }
+            if (!found) {
+                std::cout << "Model cache: " << name << " referenced by " << path << " not found" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // whether the attribute at `position` belongs to an <include> element
+    static bool isIncludeAttribute(const std::string &xml, size_t position) {
+        size_t open = xml.rfind('<', position);
+        return open != std::string::npos && xml.compare(open, 8, "<include") == 0;
+    }
+
+    static mjModel *loadEntry(const std::filesystem::path &path) {
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st = {};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        auto size = static_cast<size_t>(st.st_size);
+        void *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+#else
+        std::string content;
+        if (!readFile(path, content) || content.empty()) {
+            return nullptr;
+        }
+        const void *data = content.data();
+        size_t size = content.size();
+#endif
+
+        // mjVFS is large, keep it off the stack
+        auto vfs = std::make_unique<mjVFS>();
+        mj_defaultVFS(vfs.get());
+        mjModel *model = nullptr;
+        if (mj_addBufferVFS(vfs.get(), "model.mjb", data, static_cast<int>(size)) == 0) {
+            model = mj_loadModel("model.mjb", vfs.get());
+        }
+        mj_deleteVFS(vfs.get());
+#ifdef __linux__
+        ::munmap(data, size);
+#endif
+
+        if (model == nullptr) {
+            std::cout << "Model cache: discarding unreadable entry " << path << std::endl;
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+        return model;
+    }
+
+    void store(const mjModel *model, const std::filesystem::path &entry) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            std::cout << "Model cache: could not create " << directory << ": " << ec.message() << std::endl;
+            return;
+        }
+
+        // written under a temporary name, so a concurrent reader never sees half a file
+        std::filesystem::path temporary = entry;
+#ifdef __linux__
+        temporary += ".tmp" + std::to_string(::getpid());
+#else
+        temporary += ".tmp" + std::to_string(std::random_device()());
+#endif
+        mj_saveModel(model, temporary.c_str(), nullptr, 0);
+        std::filesystem::rename(temporary, entry, ec);
+        if (ec) {
+            std::cout << "Model cache: could not write " << entry << ": " << ec.message() << std::endl;
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+        prune();
+    }
+
+    // delete the least recently used entries until the cache fits in `maxBytes`
+    void prune() {
+        struct Entry {
+            std::filesystem::path path;
+            uintmax_t size;
+            std::filesystem::file_time_type used;
+        };
+        std::vector<Entry> entries;
+        uintmax_t total = 0;
+        std::error_code ec;
+        for (const auto &file: std::filesystem::directory_iterator(directory, ec)) {
+            if (file.path().extension() != ".mjb") {
+                continue;
+            }
+            Entry e{file.path(), file.file_size(ec), file.last_write_time(ec)};
+            total += e.size;
+            entries.push_back(e);
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+        for (const auto &e: entries) {
+            if (total <= maxBytes) {
+                break;
+            }
+            std::filesystem::remove(e.path, ec);
+            total -= e.size;
+        }
+    }
+
+    std::string directory;
+    uintmax_t maxBytes;
+};
+
+#endif //QMUJOCOSIM_MODEL_CACHE_HPP
@@ -0,0 +1,266 @@
+#ifndef QMUJOCOSIM_MODEL_LOADER_HPP
+#define QMUJOCOSIM_MODEL_LOADER_HPP
+
+#include <functional>
+#include <optional>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <memory>
+
+#include <mujoco/mujoco.h>
+
+#include "model_cache.hpp"
+#include "trace_recorder.hpp"
+
+/**
+ * Parses and compiles models on a background thread, latest request wins.
+ *
+ * MuJoCo cannot interrupt a compile, so cancelling (or a newer request) lets the running `mj_loadXML` finish and
+ * throws its model away; the newest request is compiled next. Results and progress are reported on the loader
+ * thread; nothing here touches OpenGL, the caller creates the rendering context for the new model itself.
+ * Models served from the cache were never parsed; `reparseForSave` parses their XML on the same thread when it is
+ * needed for `mj_saveLastXML`.
+ */
+class ModelLoader {
+public:
+    enum Stage {
+        COMPILING,   // parsing, compiling, or reading a binary model
+        DONE,
+    };
+
+    struct Result {
+        uint64_t ticket = 0;   // as returned by `load`
+        std::string path;
+        mjModel *model = nullptr;   // owned by the receiver; null on failure or cancellation
+        std::string error;
+        bool cancelled = false;
+        bool fromCache = false;   // read from the compiled-model cache, so its XML was not parsed
+        std::string cacheKey;     // `ModelCache::computeKey` of the inputs when loaded through the cache
+        double seconds = 0;
+    };
+
+    using Callback = std::function<void(Result &&result)>;
+    using ProgressCallback = std::function<void(uint64_t ticket, const std::string &path, Stage stage)>;
+    using SaveCallback = std::function<void(const std::string &error)>;
+
+    explicit ModelLoader(Callback done, ProgressCallback progress = nullptr)
+            : done(std::move(done)), progress(std::move(progress)) {
+        worker = std::thread([this]() { run(); });
+    }
+
+    // waits for a running compile to finish
+    ~ModelLoader() {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            stop = true;
+            pending.reset();
+            pendingSaves.clear();
+            generation++;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    ModelLoader(const ModelLoader &) = delete;
+
+    ModelLoader &operator=(const ModelLoader &) = delete;
+
+    /**
+     * Queue `path` for loading, replacing the pending request and cancelling the running one.
+     * @return ticket identifying the result
+     */
+    uint64_t load(const std::string &path) {
+        uint64_t ticket;
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            ticket = ++lastTicket;
+            pending = Request{ticket, path};
+            generation++;
+        }
+        cv.notify_all();
+        return ticket;
+    }
+
+    // drop the pending request; the running one is reported as cancelled when it finishes
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            pending.reset();
+            generation++;
+        }
+    }
+
+    /**
+     * Parse `xmlPath` again, then call `save` on the loader thread, where `mj_saveLastXML` now writes that XML.
+     * Loads run on the same thread, so nothing else is parsed in between. Queued saves run before the next load.
+     * @param key `Result::cacheKey` of the model to save; if the inputs no longer match it, the file changed since
+     * the model was loaded and `save` gets the reason instead of a parsed XML
+     * @param save called with an empty `error` once the XML is parsed
+     */
+    void reparseForSave(const std::string &xmlPath, const std::string &key, SaveCallback save) {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            pendingSaves.push_back(SaveRequest{xmlPath, key, std::move(save)});
+        }
+        cv.notify_all();
+    }
+
+    /**
+     * Serve XML files through a `ModelCache` in `directory`; applies to the next request.
+     * @param maxBytes cache size, 0 disables the cache
+     */
+    void setCache(const std::string &directory, uintmax_t maxBytes) {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        cacheDirectory = directory;
+        cacheMaxBytes = maxBytes;
+    }
+
+    bool isBusy() const {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        return busy || pending.has_value() || !pendingSaves.empty();
+    }
+
+    /**
+     * Load an `.xml` or `.mjb` file on the calling thread.
+     * @param cache if set, XML files are looked up in and added to it
+     * @return the model, or null with `error` set
+     */
+    static mjModel *loadFile(const std::string &path, std::string &error, ModelCache *cache = nullptr,
+                             bool *fromCache = nullptr, std::string *cacheKey = nullptr) {
+        std::string suffix = path.substr(path.find_last_of('.') + 1);
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        mjModel *model = nullptr;
+        char buffer[1000] = "Could not load binary model";
+        if (suffix == "xml" && cache) {
+            return cache->load(path, error, fromCache, cacheKey);
+        } else if (suffix == "xml") {
+            model = mj_loadXML(path.c_str(), nullptr, buffer, sizeof(buffer));
+        } else if (suffix == "mjb") {
+            model = mj_loadModel(path.c_str(), nullptr);
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "Only '.xml' and '.mjb' model files are supported.");
+        }
+        if (model == nullptr) {
+            error = buffer;
+        }
+        return model;
+    }
+
+private:
+    struct Request {
+        uint64_t ticket;
+        std::string path;
+    };
+
+    struct SaveRequest {
+        std::string path;
+        std::string key;
+        SaveCallback save;
+    };
+
+    void run() {
+        TraceRecorder::instance().nameThread("model loader");
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this]() { return stop || pending.has_value() || !pendingSaves.empty(); });
+            if (stop) {
+                return;
+            }
+
+            if (!pendingSaves.empty()) {
+                SaveRequest save = std::move(pendingSaves.front());
+                pendingSaves.pop_front();
+                busy = true;
+                lock.unlock();
+
+                reparse(save);
+
+                lock.lock();
+                busy = false;
+                cv.notify_all();
+                continue;
+            }
+
+            Request request = std::move(*pending);
+            pending.reset();
+            busy = true;
+            uint64_t started = generation.load();
+            std::unique_ptr<ModelCache> cache;
+            if (cacheMaxBytes > 0) {
+                cache = std::make_unique<ModelCache>(cacheDirectory, cacheMaxBytes);
+            }
+            lock.unlock();
+
+            if (progress) {
+                progress(request.ticket, request.path, COMPILING);
+            }
+            auto start = std::chrono::steady_clock::now();
+            Result result;
+            result.ticket = request.ticket;
+            result.path = request.path;
+            {
+                TraceSpan span("loadModel", "load");
+                result.model = loadFile(request.path, result.error, cache.get(), &result.fromCache,
+                                        &result.cacheKey);
+            }
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (generation.load() != started) {
+                mj_deleteModel(result.model);
+                result.model = nullptr;
+                result.cancelled = true;
+            }
+            if (progress) {
+                progress(request.ticket, request.path, DONE);
+            }
+            done(std::move(result));
+
+            lock.lock();
+            busy = false;
+            cv.notify_all();
+        }
+    }
+
+    void reparse(const SaveRequest &request) {
+        TraceSpan span("reparseForSave", "load");
+        if (ModelCache::computeKey(request.path) != request.key) {
+            request.save(request.path + " changed since the model was loaded, not saving its XML.");
+            return;
+        }
+        char buffer[1000] = "";
+        mjModel *parsed = mj_loadXML(request.path.c_str(), nullptr, buffer, sizeof(buffer));
+        if (parsed == nullptr) {
+            request.save(buffer);
+            return;
+        }
+        mj_deleteModel(parsed);
+        request.save(std::string());
+    }
+
+    Callback done;
+    ProgressCallback progress;
+
+    std::thread worker;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::optional<Request> pending;
+    std::deque<SaveRequest> pendingSaves;
+    uint64_t lastTicket = 0;
+    std::string cacheDirectory;
+    uintmax_t cacheMaxBytes = 0;
+    bool busy = false;
+    bool stop = false;
+    std::atomic<uint64_t> generation = 0;   // bumped under `mtx` by every request and cancellation
+};
+
+#endif //QMUJOCOSIM_MODEL_LOADER_HPP
@@ -0,0 +1,155 @@
+#ifndef QMUJOCOSIM_PACING_SCHEDULER_HPP
+#define QMUJOCOSIM_PACING_SCHEDULER_HPP
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __linux__
+
+#include <ctime>
+#include <cerrno>
+#include <sys/prctl.h>
+
+#endif
+
+
+struct PacingStatistics {
+    long long count = 0;        // number of waits
+    double meanJitter = 0;      // mean wake-up delay past the deadline (seconds)
+    double rmsJitter = 0;       // root mean square of the wake-up delay (seconds)
+    double maxJitter = 0;       // worst wake-up delay (seconds)
+    long long late = 0;         // waits that woke up more than `kLateThreshold` after the deadline
+};
+
+
+/**
+ * Waits for absolute deadlines with a coarse kernel sleep followed by a short spin.
+ *
+ * The spin window adapts to the wake-up latency observed from the kernel sleep, so the thread sleeps for
+ * almost all of the interval and still wakes up within a few microseconds of the deadline.
+ *
+ * `wait` and `configureCurrentThread` must be called from the paced thread; the statistics can be read
+ * from any thread.
+ */
+class PacingScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::nanoseconds kTimerSlack{1000};
+    static constexpr std::chrono::nanoseconds kMinSpin{20000};
+    static constexpr std::chrono::nanoseconds kMaxSpin{1000000};
+    static constexpr double kLateThreshold = 1e-3;
+
+    /**
+     * Reduce the kernel timer slack (default 50 us) of the calling thread.
+     */
+    static void configureCurrentThread() {
+#ifdef __linux__
+        prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(kTimerSlack.count()), 0, 0, 0);
+#endif
+    }
+
+    /**
+     * Block until `deadline`.
+     * @param busyWait spin (yielding) for the whole interval instead of sleeping
+     * @return false if the deadline had already passed, so nothing was waited for
+     */
+    bool wait(Clock::time_point deadline, bool busyWait) {
+        // already behind: nothing to wait for, and no wake-up to measure
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+
+        if (!busyWait) {
+            auto spin = std::chrono::nanoseconds(static_cast<long long>(spinWindow));
+            auto sleepUntil = deadline - spin;
+            if (Clock::now() < sleepUntil) {
+                sleepAbsolute(sleepUntil);
+
+                // track how late the kernel wakes us up to size the spin window
+                double overshoot = std::chrono::duration<double, std::nano>(Clock::now() - sleepUntil).count();
+                overshootEstimate += 0.05 * (std::max(0.0, overshoot) - overshootEstimate);
+                spinWindow = std::clamp(2 * overshootEstimate,
+                                        static_cast<double>(kMinSpin.count()),
+                                        static_cast<double>(kMaxSpin.count()));
+            }
+        }
+
+        auto now = Clock::now();
+        while (now < deadline) {
+            std::this_thread::yield();
+            now = Clock::now();
+        }
+
+        record(std::chrono::duration<double>(now - deadline).count());
+        return true;
+    }
+
+    PacingStatistics statistics() const {
+        PacingStatistics stat;
+        stat.count = count.load(std::memory_order_relaxed);
+        stat.late = late.load(std::memory_order_relaxed);
+        stat.maxJitter = maxJitter.load(std::memory_order_relaxed);
+        if (stat.count > 0) {
+            stat.meanJitter = sumJitter.load(std::memory_order_relaxed) / stat.count;
+            stat.rmsJitter = std::sqrt(sumSquaredJitter.load(std::memory_order_relaxed) / stat.count);
+        }
+        return stat;
+    }
+
+    // applied by the paced thread on its next wait
+    void resetStatistics() {
+        resetRequested = true;
+    }
+
+private:
+    static void sleepAbsolute(Clock::time_point t) {
+#ifdef __linux__
+        // steady_clock is CLOCK_MONOTONIC on Linux
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+        timespec ts{};
+        ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#else
+        std::this_thread::sleep_until(t);
+#endif
+    }
+
+    // only called from the paced thread, so plain load/store pairs suffice
+    void record(double jitter) {
+        if (resetRequested.exchange(false)) {
+            count = 0;
+            late = 0;
+            sumJitter = 0;
+            sumSquaredJitter = 0;
+            maxJitter = 0;
+        }
+
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sumJitter.store(sumJitter.load(std::memory_order_relaxed) + jitter, std::memory_order_relaxed);
+        sumSquaredJitter.store(sumSquaredJitter.load(std::memory_order_relaxed) + jitter * jitter,
+                               std::memory_order_relaxed);
+        if (jitter > maxJitter.load(std::memory_order_relaxed)) {
+            maxJitter.store(jitter, std::memory_order_relaxed);
+        }
+        if (jitter > kLateThreshold) {
+            late.store(late.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    double overshootEstimate = 0;                             // ns
+    double spinWindow = static_cast<double>(kMaxSpin.count()); // ns
+
+    std::atomic<long long> count = 0;
+    std::atomic<long long> late = 0;
+    std::atomic<double> sumJitter = 0;
+    std::atomic<double> sumSquaredJitter = 0;
+    std::atomic<double> maxJitter = 0;
+    std::atomic_bool resetRequested = false;
+};
+
+#endif //QMUJOCOSIM_PACING_SCHEDULER_HPP
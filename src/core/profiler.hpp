@@ -7,11 +7,29 @@
 
 #include <cstring>
 #include <memory>
+#include <vector>
+#include <string>
+#include <cstdio>
 
 #include <mujoco/mujoco.h>
 
+#include "step_latency.hpp"
+#include "lock_stats.hpp"
+#include "realtime_stats.hpp"
+
 class Profiler {
 public:
+    // CPU time of the stages of one painted frame, in msec
+    struct RenderTimes {
+        double lock = 0;      // waiting for the simulation mutex
+        double profiler = 0;  // statistics bookkeeping before the frame: draining rings, profiler figures
+        double scene = 0;     // mjv_updateScene and the per-view camera updates
+        double render = 0;    // mjr_render of every view
+        double overlay = 0;   // text overlays and profiler figures
+        double swap = 0;      // end of paintGL until the frame was swapped, including the wait for vsync
+        double fps = 0;       // frames actually swapped per second
+    };
+
     explicit Profiler() = default;
 
     // init profiler figures
@@ -21,24 +39,49 @@ public:
         mjv_defaultFigure(&figcost);
         mjv_defaultFigure(&figtimer);
         mjv_defaultFigure(&figsize);
+        mjv_defaultFigure(&figthreads);
+        mjv_defaultFigure(&figrender);
+        mjv_defaultFigure(&figfps);
+        mjv_defaultFigure(&figlatency);
+        mjv_defaultFigure(&figstagetail);
+        mjv_defaultFigure(&fighistogram);
 
         // titles
         std::strcpy(figconstraint.title, "Counts");
         std::strcpy(figcost.title, "Convergence (log 10)");
         std::strcpy(figsize.title, "Dimensions");
         std::strcpy(figtimer.title, "CPU time (msec)");
+        std::strcpy(figthreads.title, "Thread pool speedup");
+        std::strcpy(figrender.title, "Render time (msec)");
+        std::strcpy(figfps.title, "Frame rate");
+        std::strcpy(figlatency.title, "Step latency (msec)");
+        std::strcpy(figstagetail.title, "Stage p99 (msec)");
+        std::strcpy(fighistogram.title, "Step time distribution (%)");
 
         // x-labels
         std::strcpy(figconstraint.xlabel, "Solver iteration");
         std::strcpy(figcost.xlabel, "Solver iteration");
         std::strcpy(figsize.xlabel, "Video frame");
         std::strcpy(figtimer.xlabel, "Video frame");
+        std::strcpy(figthreads.xlabel, "Video frame");
+        std::strcpy(figrender.xlabel, "Video frame");
+        std::strcpy(figfps.xlabel, "Video frame");
+        std::strcpy(figlatency.xlabel, "Video frame");
+        std::strcpy(figstagetail.xlabel, "Video frame");
+        std::strcpy(fighistogram.xlabel, "Step time (msec)");
 
         // y-tick number formats
         std::strcpy(figconstraint.yformat, "%.0f");
         std::strcpy(figcost.yformat, "%.1f");
         std::strcpy(figsize.yformat, "%.0f");
         std::strcpy(figtimer.yformat, "%.2f");
+        std::strcpy(figthreads.yformat, "%.1f");
+        std::strcpy(figrender.yformat, "%.2f");
+        std::strcpy(figfps.yformat, "%.0f");
+        std::strcpy(figlatency.yformat, "%.2f");
+        std::strcpy(figstagetail.yformat, "%.2f");
+        std::strcpy(fighistogram.yformat, "%.0f");
+        std::strcpy(fighistogram.xformat, "%.2f");
 
         // colors
         figconstraint.figurergba[0] = 0.1f;
@@ -49,6 +92,19 @@ public:
         figcost.figurergba[3] = 0.5f;
         figsize.figurergba[3] = 0.5f;
         figtimer.figurergba[3] = 0.5f;
+        figthreads.figurergba[2] = 0.2f;
+        figthreads.figurergba[3] = 0.5f;
+        figrender.figurergba[2] = 0.2f;
+        figrender.figurergba[3] = 0.5f;
+        figfps.figurergba[2] = 0.2f;
+        figfps.figurergba[3] = 0.5f;
+        figlatency.figurergba[2] = 0.2f;
+        figlatency.figurergba[3] = 0.5f;
+        figstagetail.figurergba[2] = 0.2f;
+        figstagetail.figurergba[3] = 0.5f;
+        fighistogram.figurergba[2] = 0.2f;
+        fighistogram.figurergba[3] = 0.5f;
+        fighistogram.flg_barplot = 1;
 
         // repeat line colors for constraint and cost figures
         mjvFigure *fig = &figcost;
@@ -84,6 +140,24 @@ public:
         std::strcpy(figtimer.linename[2], "prepare");
         std::strcpy(figtimer.linename[3], "solve");
         std::strcpy(figtimer.linename[4], "other");
+        std::strcpy(figthreads.linename[0], "speedup");
+        std::strcpy(figthreads.linename[1], "workers");
+        std::strcpy(figrender.linename[0], "lock");
+        std::strcpy(figrender.linename[1], "scene");
+        std::strcpy(figrender.linename[2], "render");
+        std::strcpy(figrender.linename[3], "overlay");
+        std::strcpy(figrender.linename[4], "swap");
+        std::strcpy(figrender.linename[5], "profiler");
+        std::strcpy(figfps.linename[0], "fps");
+        std::strcpy(figlatency.linename[0], "p50");
+        std::strcpy(figlatency.linename[1], "p95");
+        std::strcpy(figlatency.linename[2], "p99");
+        std::strcpy(figlatency.linename[3], "max");
+        std::strcpy(figstagetail.linename[0], "collision");
+        std::strcpy(figstagetail.linename[1], "make");
+        std::strcpy(figstagetail.linename[2], "project");
+        std::strcpy(figstagetail.linename[3], "constraint");
+        std::strcpy(fighistogram.linename[0], "total");
 
         // grid sizes
         figconstraint.gridsize[0] = 5;
@@ -94,6 +168,18 @@ public:
         figsize.gridsize[1] = 5;
         figtimer.gridsize[0] = 3;
         figtimer.gridsize[1] = 5;
+        figthreads.gridsize[0] = 3;
+        figthreads.gridsize[1] = 5;
+        figrender.gridsize[0] = 3;
+        figrender.gridsize[1] = 5;
+        figfps.gridsize[0] = 3;
+        figfps.gridsize[1] = 5;
+        figlatency.gridsize[0] = 3;
+        figlatency.gridsize[1] = 5;
+        figstagetail.gridsize[0] = 3;
+        figstagetail.gridsize[1] = 5;
+        fighistogram.gridsize[0] = 5;
+        fighistogram.gridsize[1] = 5;
 
         // minimum ranges
         figconstraint.range[0][0] = 0;
@@ -112,6 +198,30 @@ public:
         figtimer.range[0][1] = 0;
         figtimer.range[1][0] = 0;
         figtimer.range[1][1] = 0.4f;
+        figthreads.range[0][0] = -200;
+        figthreads.range[0][1] = 0;
+        figthreads.range[1][0] = 0;
+        figthreads.range[1][1] = 2;
+        figrender.range[0][0] = -200;
+        figrender.range[0][1] = 0;
+        figrender.range[1][0] = 0;
+        figrender.range[1][1] = 1;
+        figfps.range[0][0] = -200;
+        figfps.range[0][1] = 0;
+        figfps.range[1][0] = 0;
+        figfps.range[1][1] = 60;
+        figlatency.range[0][0] = -200;
+        figlatency.range[0][1] = 0;
+        figlatency.range[1][0] = 0;
+        figlatency.range[1][1] = 0.4f;
+        figstagetail.range[0][0] = -200;
+        figstagetail.range[0][1] = 0;
+        figstagetail.range[1][0] = 0;
+        figstagetail.range[1][1] = 0.2f;
+        fighistogram.range[0][0] = 0;
+        fighistogram.range[0][1] = 0.4f;
+        fighistogram.range[1][0] = 0;
+        fighistogram.range[1][1] = 20;
 
         // init x axis on history figures (do not show yet)
         for (int n = 0; n < 6; n++) {
@@ -120,6 +230,158 @@ public:
                 figsize.linedata[n][2 * i] = -i;
             }
         }
+        for (int n = 0; n < 2; n++) {
+            for (int i = 0; i < mjMAXLINEPNT; i++) {
+                figthreads.linedata[n][2 * i] = -i;
+            }
+        }
+        for (int n = 0; n < 6; n++) {
+            for (int i = 0; i < mjMAXLINEPNT; i++) {
+                figrender.linedata[n][2 * i] = -i;
+            }
+        }
+        for (int i = 0; i < mjMAXLINEPNT; i++) {
+            figfps.linedata[0][2 * i] = -i;
+        }
+        for (int n = 0; n < 4; n++) {
+            for (int i = 0; i < mjMAXLINEPNT; i++) {
+                figlatency.linedata[n][2 * i] = -i;
+                figstagetail.linedata[n][2 * i] = -i;
+            }
+        }
+    }
+
+    /**
+     * Append the percentiles of the rolling step window and redraw its histogram. Averages over a video frame
+     * hide the occasional slow step that misses a real-time deadline; these show it.
+     */
+    void updateLatency(const StepLatency &latency) {
+        if (latency.size() == 0) {
+            return;
+        }
+
+        StepLatency::Percentiles total = latency.percentiles(StepLatency::TOTAL);
+        float ldata[4] = {total.p50, total.p95, total.p99, total.max};
+        float sdata[4] = {
+                latency.percentiles(StepLatency::COLLISION).p99,
+                latency.percentiles(StepLatency::MAKE).p99,
+                latency.percentiles(StepLatency::PROJECT).p99,
+                latency.percentiles(StepLatency::CONSTRAINT).p99
+        };
+
+        int pnt = mjMIN(201, figlatency.linepnt[0] + 1);
+        for (int n = 0; n < 4; n++) {
+            // shift data
+            for (int i = pnt - 1; i > 0; i--) {
+                figlatency.linedata[n][2 * i + 1] = figlatency.linedata[n][2 * i - 1];
+                figstagetail.linedata[n][2 * i + 1] = figstagetail.linedata[n][2 * i - 1];
+            }
+
+            // assign new
+            figlatency.linepnt[n] = pnt;
+            figlatency.linedata[n][1] = ldata[n];
+            figstagetail.linepnt[n] = pnt;
+            figstagetail.linedata[n][1] = sdata[n];
+        }
+
+        // bins up to twice the p99, so the bulk is resolved and the tail lands in the last bin
+        float binWidth = mjMAX(2 * total.p99, 1e-3f) / kHistogramBins;
+        std::vector<int> counts = latency.histogram(StepLatency::TOTAL, kHistogramBins, binWidth);
+        auto steps = static_cast<float>(latency.size());
+        fighistogram.linepnt[0] = kHistogramBins;
+        for (int i = 0; i < kHistogramBins; i++) {
+            fighistogram.linedata[0][2 * i] = (static_cast<float>(i) + 0.5f) * binWidth;
+            fighistogram.linedata[0][2 * i + 1] = 100 * static_cast<float>(counts[i]) / steps;
+        }
+        fighistogram.range[0][1] = binWidth * kHistogramBins;
+    }
+
+    /**
+     * Append the timings of the last painted frame, to tell physics-, lock- and render-bound sessions apart.
+     */
+    void updateRender(const RenderTimes &times) {
+        float tdata[6] = {
+                static_cast<float>(times.lock),
+                static_cast<float>(times.scene),
+                static_cast<float>(times.render),
+                static_cast<float>(times.overlay),
+                static_cast<float>(times.swap),
+                static_cast<float>(times.profiler)
+        };
+
+        int pnt = mjMIN(201, figrender.linepnt[0] + 1);
+        for (int n = 0; n < 6; n++) {
+            // shift data
+            for (int i = pnt - 1; i > 0; i--) {
+                figrender.linedata[n][2 * i + 1] = figrender.linedata[n][2 * i - 1];
+            }
+
+            // assign new
+            figrender.linepnt[n] = pnt;
+            figrender.linedata[n][1] = tdata[n];
+        }
+
+        pnt = mjMIN(201, figfps.linepnt[0] + 1);
+        for (int i = pnt - 1; i > 0; i--) {
+            figfps.linedata[0][2 * i + 1] = figfps.linedata[0][2 * i - 1];
+        }
+        figfps.linepnt[0] = pnt;
+        figfps.linedata[0][1] = static_cast<float>(times.fps);
+    }
+
+    /**
+     * Append the measured thread pool speedup (single-threaded over threaded step time) and the worker count.
+     * Nothing is plotted while single-threaded or before both step times have been measured.
+     */
+    void updateThreads(double speedup, int nworker) {
+        if (nworker <= 0 || speedup <= 0) {
+            return;
+        }
+        float tdata[2] = {static_cast<float>(speedup), static_cast<float>(nworker)};
+
+        int pnt = mjMIN(201, figthreads.linepnt[0] + 1);
+        for (int n = 0; n < 2; n++) {
+            // shift data
+            for (int i = pnt - 1; i > 0; i--) {
+                figthreads.linedata[n][2 * i + 1] = figthreads.linedata[n][2 * i - 1];
+            }
+
+            // assign new
+            figthreads.linepnt[n] = pnt;
+            figthreads.linedata[n][1] = tdata[n];
+        }
+    }
+
+    /**
+     * Summarize how well the simulation keeps up with the wall clock, against the target factor set by the
+     * slowdown.
+     */
+    void updateRealtime(const RealtimeStatistics &stat, double targetFactor) {
+        char line[128];
+        realtimenames = "Real-time factor\nResyncs\nDeadline misses\nLongest stall";
+        std::snprintf(line, sizeof(line), "%.1f%% (target %.3g%%)\n%lld\n%lld of %lld\n%.1f ms",
+                      100 * stat.realtimeFactor, 100 * targetFactor, stat.resyncs, stat.deadlineMisses,
+                      stat.iterations, 1e3 * stat.longestStall);
+        realtimevalues = line;
+    }
+
+    /**
+     * Tabulate the contention on the simulation mutex per call site: acquisitions, contended share, and the mean
+     * and worst wait and hold times in msec.
+     */
+    void updateLocks(const std::vector<LockStats::Summary> &sites) {
+        locknames = "Simulation mutex";
+        lockvalues = "count  cont  wait avg/max  hold avg/max";
+        char line[128];
+        for (const auto &site: sites) {
+            double n = static_cast<double>(site.count);
+            std::snprintf(line, sizeof(line), "\n%llu  %.0f%%  %.3f/%.2f  %.3f/%.2f",
+                          static_cast<unsigned long long>(site.count), 100 * static_cast<double>(site.contended) / n,
+                          1e3 * site.waitTotal / n, 1e3 * site.waitMax, 1e3 * site.holdTotal / n, 1e3 * site.holdMax);
+            locknames += "\n";
+            locknames += site.name;
+            lockvalues += line;
+        }
     }
 
     // update profiler figures
@@ -274,15 +536,58 @@ public:
         mjr_figure(viewport, &figcost, con);
         viewport.bottom += rect.height / 4;
         mjr_figure(viewport, &figconstraint, con);
+
+        // render side next to the physics timers, then the thread pool once there is something to show
+        viewport.left -= rect.width / 4;
+        viewport.bottom = rect.bottom;
+        if (figrender.linepnt[0] > 0) {
+            mjr_figure(viewport, &figrender, con);
+            viewport.bottom += rect.height / 4;
+            mjr_figure(viewport, &figfps, con);
+            viewport.bottom += rect.height / 4;
+        }
+        if (figthreads.linepnt[0] > 0) {
+            mjr_figure(viewport, &figthreads, con);
+        }
+
+        // real-time accounting and mutex contention in the free quarter, below the real-time label
+        if (!realtimenames.empty() || !locknames.empty()) {
+            std::string names = realtimenames + "\n\n" + locknames;
+            std::string values = realtimevalues + "\n\n" + lockvalues;
+            mjrRect text = {rect.left, rect.bottom, rect.width / 4, rect.height - rect.height / 8};
+            mjr_overlay(mjFONT_NORMAL, mjGRID_TOPLEFT, text, names.c_str(), values.c_str(), con);
+        }
+
+        // step latency distribution in a third column
+        viewport.left -= rect.width / 4;
+        viewport.bottom = rect.bottom;
+        if (figlatency.linepnt[0] > 0) {
+            mjr_figure(viewport, &fighistogram, con);
+            viewport.bottom += rect.height / 4;
+            mjr_figure(viewport, &figlatency, con);
+            viewport.bottom += rect.height / 4;
+            mjr_figure(viewport, &figstagetail, con);
+        }
     }
 
 private:
     static constexpr int kConstraintNum = 5;
     static constexpr int kCostNum = 3;
+    static constexpr int kHistogramBins = 40;
     mjvFigure figconstraint = {};
     mjvFigure figcost = {};
     mjvFigure figtimer = {};
     mjvFigure figsize = {};
+    mjvFigure figthreads = {};
+    mjvFigure figrender = {};
+    mjvFigure figfps = {};
+    mjvFigure figlatency = {};
+    mjvFigure figstagetail = {};
+    mjvFigure fighistogram = {};
+    std::string realtimenames;
+    std::string realtimevalues;
+    std::string locknames;
+    std::string lockvalues;
 };
 
 
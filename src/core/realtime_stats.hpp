@@ -0,0 +1,139 @@
+#ifndef QMUJOCOSIM_REALTIME_STATS_HPP
+#define QMUJOCOSIM_REALTIME_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+
+struct RealtimeStatistics {
+    double realtimeFactor = 0;   // simulation time over wall time in the last `kWindow`, 0 until measured
+    long long iterations = 0;    // simulation loop iterations while running
+    long long resyncs = 0;       // re-synchronizations because the simulation drifted more than `syncMisalign`
+    long long deadlineMisses = 0;  // iterations that ended more than `kMissThreshold` behind the wall clock
+    double longestStall = 0;     // longest wall time between two iterations while running (seconds)
+};
+
+
+/**
+ * Real-time accounting of the simulation loop, which `measured_slowdown` (one sample per in-sync batch) cannot
+ * provide: a rolling real-time factor, re-synchronizations, deadline misses and the longest stall.
+ *
+ * The `iteration`, `resync`, `finished` and `paused` hooks must be called from the simulation thread; the
+ * statistics can be read from any thread.
+ */
+class RealtimeStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds kWindow{2000};
+    static constexpr std::chrono::milliseconds kSampleInterval{20};
+    static constexpr double kMissThreshold = 1e-3;
+
+    // start of an iteration at `now` with simulation time `simTime`
+    void iteration(Clock::time_point now, double simTime) {
+        applyReset();
+        iterations.store(iterations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (running) {
+            raise(longestStall, std::chrono::duration<double>(now - lastIteration).count());
+        }
+        running = true;
+        lastIteration = now;
+
+        // reset, scrubbed or new model: the window no longer describes one run
+        if (count > 0 && simTime < samples[head].simTime) {
+            count = 0;
+        }
+        if (count == 0 || now - samples[head].wall >= kSampleInterval) {
+            head = (head + 1) % samples.size();
+            samples[head] = Sample{now, simTime};
+            count = std::min(count + 1, samples.size());
+        }
+
+        // oldest sample still inside the window
+        size_t oldest = (head + samples.size() - count + 1) % samples.size();
+        while (count > 2 && now - samples[oldest].wall > kWindow) {
+            oldest = (oldest + 1) % samples.size();
+            count--;
+        }
+        double wall = std::chrono::duration<double>(now - samples[oldest].wall).count();
+        if (count > 1 && wall > 0) {
+            realtimeFactor.store((simTime - samples[oldest].simTime) / wall, std::memory_order_relaxed);
+        }
+    }
+
+    void resync() {
+        resyncs.store(resyncs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // the iteration's steps are done at `now`; the simulation is on time until `deadline`
+    void finished(Clock::time_point deadline, Clock::time_point now) {
+        if (std::chrono::duration<double>(now - deadline).count() > kMissThreshold) {
+            deadlineMisses.store(deadlineMisses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    // the loop waited for the simulation to be resumed; neither the gap nor the time it covered count
+    void paused() {
+        running = false;
+        count = 0;
+    }
+
+    RealtimeStatistics statistics() const {
+        RealtimeStatistics stat;
+        stat.realtimeFactor = realtimeFactor.load(std::memory_order_relaxed);
+        stat.iterations = iterations.load(std::memory_order_relaxed);
+        stat.resyncs = resyncs.load(std::memory_order_relaxed);
+        stat.deadlineMisses = deadlineMisses.load(std::memory_order_relaxed);
+        stat.longestStall = longestStall.load(std::memory_order_relaxed);
+        return stat;
+    }
+
+    // applied by the simulation thread on its next iteration
+    void resetStatistics() {
+        resetRequested = true;
+    }
+
+private:
+    struct Sample {
+        Clock::time_point wall;
+        double simTime = 0;
+    };
+
+    void applyReset() {
+        if (resetRequested.exchange(false)) {
+            iterations = 0;
+            resyncs = 0;
+            deadlineMisses = 0;
+            longestStall = 0;
+            realtimeFactor = 0;
+            running = false;
+            count = 0;
+        }
+    }
+
+    // only the simulation thread writes, so a plain load/store pair suffices
+    static void raise(std::atomic<double> &max, double value) {
+        if (value > max.load(std::memory_order_relaxed)) {
+            max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<double> realtimeFactor = 0;
+    std::atomic<long long> iterations = 0;
+    std::atomic<long long> resyncs = 0;
+    std::atomic<long long> deadlineMisses = 0;
+    std::atomic<double> longestStall = 0;
+    std::atomic_bool resetRequested = false;
+
+    // simulation thread; room for `kWindow` at `kSampleInterval` and some slack
+    std::array<Sample, 2 * (kWindow / kSampleInterval)> samples{};
+    size_t head = 0;
+    size_t count = 0;
+    bool running = false;
+    Clock::time_point lastIteration;
+};
+
+#endif //QMUJOCOSIM_REALTIME_STATS_HPP
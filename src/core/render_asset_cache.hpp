@@ -0,0 +1,133 @@
+#ifndef QMUJOCOSIM_RENDER_ASSET_CACHE_HPP
+#define QMUJOCOSIM_RENDER_ASSET_CACHE_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include <mujoco/mujoco.h>
+
+#include "content_hash.hpp"
+
+
+/**
+ * Remembers what an `mjrContext` holds, so that loading the same or a slightly edited model re-uploads only the
+ * meshes, textures and height fields whose content changed (`mjr_uploadMesh` and friends) instead of rebuilding
+ * the whole context with `mjr_makeContext`.
+ *
+ * The context is rebuilt when anything else it was made from differs: asset counts, texture types, skins (which
+ * have no upload function), the `mjVisual` settings (offscreen size, shadow map, built-in geometry quality, fog
+ * color) or the model extent, which scales the shadow clip and fog distances baked into the context.
+ * The OpenGL context must be current for `update`.
+ */
+class RenderAssetCache {
+public:
+    struct Stats {
+        bool rebuilt = false;
+        int uploaded = 0;   // assets re-uploaded into the existing context
+        int total = 0;      // meshes + textures + height fields of the model
+    };
+
+    Stats update(const mjModel *m, mjrContext *con) {
+        Stats stats;
+        stats.total = m->nmesh + m->ntex + m->nhfield;
+
+        uint64_t newLayout = layoutHash(m);
+        if (!valid || newLayout != layout) {
+            mjr_makeContext(m, con, mjFONTSCALE_100);
+            stats.rebuilt = true;
+        }
+
+        std::vector<uint64_t> newMeshes(m->nmesh), newTextures(m->ntex), newHFields(m->nhfield);
+        for (int i = 0; i < m->nmesh; i++) {
+            newMeshes[i] = meshHash(m, i);
+            if (!stats.rebuilt && newMeshes[i] != meshes[i]) {
+                mjr_uploadMesh(m, con, i);
+                stats.uploaded++;
+            }
+        }
+        for (int i = 0; i < m->ntex; i++) {
+            newTextures[i] = textureHash(m, i);
+            if (!stats.rebuilt && newTextures[i] != textures[i]) {
+                mjr_uploadTexture(m, con, i);
+                stats.uploaded++;
+            }
+        }
+        for (int i = 0; i < m->nhfield; i++) {
+            newHFields[i] = hfieldHash(m, i);
+            if (!stats.rebuilt && newHFields[i] != hfields[i]) {
+                mjr_uploadHField(m, con, i);
+                stats.uploaded++;
+            }
+        }
+
+        layout = newLayout;
+        meshes = std::move(newMeshes);
+        textures = std::move(newTextures);
+        hfields = std::move(newHFields);
+        valid = true;
+        return stats;
+    }
+
+    // the context was made or freed elsewhere; the next `update` rebuilds it
+    void clear() {
+        valid = false;
+    }
+
+private:
+    static uint64_t layoutHash(const mjModel *m) {
+        ContentHash hash;
+        int counts[] = {m->nmesh, m->ntex, m->nhfield, m->nskin, m->nflex, m->nskinvert, m->nskinface,
+                        m->nskintexvert};
+        hash.add(counts, sizeof(counts));
+        hash.add(&m->vis, sizeof(mjVisual));
+        hash.add(&m->stat.extent, sizeof(m->stat.extent));
+        hash.addArray(m->tex_type, m->ntex);
+        hash.addArray(m->skin_vertnum, m->nskin);
+        hash.addArray(m->skin_face, 3L * m->nskinface);
+        hash.addArray(m->skin_texcoord, 2L * m->nskintexvert);
+        return hash.value;
+    }
+
+    static uint64_t meshHash(const mjModel *m, int i) {
+        ContentHash hash;
+        hash.addArray(m->mesh_vert + 3L * m->mesh_vertadr[i], 3L * m->mesh_vertnum[i]);
+        hash.addArray(m->mesh_normal + 3L * m->mesh_normaladr[i], 3L * m->mesh_normalnum[i]);
+        hash.addArray(m->mesh_face + 3L * m->mesh_faceadr[i], 3L * m->mesh_facenum[i]);
+        hash.addArray(m->mesh_facenormal + 3L * m->mesh_faceadr[i], 3L * m->mesh_facenum[i]);
+        if (m->mesh_texcoordadr[i] >= 0) {
+            hash.addArray(m->mesh_texcoord + 2L * m->mesh_texcoordadr[i], 2L * m->mesh_texcoordnum[i]);
+            hash.addArray(m->mesh_facetexcoord + 3L * m->mesh_faceadr[i], 3L * m->mesh_facenum[i]);
+        }
+        // convex hull: numvert, numface, then 3 * numvert + 6 * numface ints
+        if (m->mesh_graphadr[i] >= 0) {
+            const int *graph = m->mesh_graph + m->mesh_graphadr[i];
+            hash.addArray(graph, 2 + 3L * graph[0] + 6L * graph[1]);
+        }
+        return hash.value;
+    }
+
+    static uint64_t textureHash(const mjModel *m, int i) {
+        ContentHash hash;
+        int size[] = {m->tex_width[i], m->tex_height[i]};
+        hash.add(size, sizeof(size));
+        hash.addArray(m->tex_rgb + m->tex_adr[i], 3L * m->tex_width[i] * m->tex_height[i]);
+        return hash.value;
+    }
+
+    static uint64_t hfieldHash(const mjModel *m, int i) {
+        ContentHash hash;
+        int size[] = {m->hfield_nrow[i], m->hfield_ncol[i]};
+        hash.add(size, sizeof(size));
+        hash.addArray(m->hfield_size + 4L * i, 4);
+        hash.addArray(m->hfield_data + m->hfield_adr[i], static_cast<long>(m->hfield_nrow[i]) * m->hfield_ncol[i]);
+        return hash.value;
+    }
+
+    bool valid = false;
+    uint64_t layout = 0;
+    std::vector<uint64_t> meshes;
+    std::vector<uint64_t> textures;
+    std::vector<uint64_t> hfields;
+};
+
+#endif //QMUJOCOSIM_RENDER_ASSET_CACHE_HPP
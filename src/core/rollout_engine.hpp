@@ -0,0 +1,221 @@
+#ifndef QMUJOCOSIM_ROLLOUT_ENGINE_HPP
+#define QMUJOCOSIM_ROLLOUT_ENGINE_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include <mujoco/mujoco.h>
+
+
+/**
+ * Headless engine that runs many independent rollouts of one model in parallel.
+ *
+ * The model is shared read-only by all threads (it is not owned and must outlive the engine);
+ * every thread steps its own mjData. Rollouts are distributed over per-thread queues and idle
+ * threads steal work from the back of the other queues. The calling thread is worker 0; the other
+ * workers are started once and wait on a condition variable between calls, so repeated short
+ * rollouts do not pay for thread creation. `rollout` must not be called concurrently.
+ *
+ * States use the same layout as the history buffer (mjSTATE_INTEGRATION).
+ */
+class RolloutEngine {
+public:
+    explicit RolloutEngine(const mjModel *model, int nthread = 0) : m(model) {
+        if (m == nullptr) {
+            mju_error("RolloutEngine: model is null");
+        }
+
+        if (nthread <= 0) {
+            nthread = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+
+        state_size_ = mj_stateSize(m, mjSTATE_INTEGRATION);
+
+        datas.resize(nthread, nullptr);
+        for (auto &d: datas) {
+            d = mj_makeData(m);
+        }
+        queues = std::vector<WorkQueue>(nthread);
+
+        workers.reserve(nthread - 1);
+        for (int i = 1; i < nthread; i++) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    ~RolloutEngine() {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            stop = true;
+        }
+        cv_start.notify_all();
+        for (auto &t: workers) {
+            t.join();
+        }
+        for (auto d: datas) {
+            mj_deleteData(d);
+        }
+    }
+
+    RolloutEngine(const RolloutEngine &) = delete;
+
+    RolloutEngine &operator=(const RolloutEngine &) = delete;
+
+
+    int stateSize() const {
+        return state_size_;
+    }
+
+    int threadCount() const {
+        return static_cast<int>(datas.size());
+    }
+
+    /**
+     * Run `nrollout` rollouts of `nstep` steps each.
+     * @param initialStates nrollout x stateSize() initial states
+     * @param states output, nrollout x nstep x stateSize(); entry t holds the state after step t+1
+     */
+    void rollout(const mjtNum *initialStates, int nrollout, int nstep, mjtNum *states) {
+        if (nrollout <= 0 || nstep <= 0) {
+            return;
+        }
+
+        int nthread = std::min(threadCount(), nrollout);
+
+        // deal contiguous ranges of rollouts to the per-thread queues
+        for (int i = 0; i < nthread; i++) {
+            queues[i].items.clear();
+            int begin = static_cast<int>(static_cast<long long>(nrollout) * i / nthread);
+            int end = static_cast<int>(static_cast<long long>(nrollout) * (i + 1) / nthread);
+            for (int r = begin; r < end; r++) {
+                queues[i].items.push_back(r);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            job = Job{initialStates, nstep, states, nthread};
+            running = nthread - 1;
+            batch++;
+        }
+        cv_start.notify_all();
+
+        // the calling thread is worker 0
+        work(0, nthread, initialStates, nstep, states);
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_done.wait(lock, [this]() { return running == 0; });
+    }
+
+    std::vector<mjtNum> rollout(const std::vector<mjtNum> &initialStates, int nstep) {
+        assert(initialStates.size() % state_size_ == 0);
+        int nrollout = static_cast<int>(initialStates.size() / state_size_);
+        std::vector<mjtNum> states(static_cast<size_t>(nrollout) * nstep * state_size_);
+        rollout(initialStates.data(), nrollout, nstep, states.data());
+        return states;
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mtx;
+        std::deque<int> items;
+    };
+
+    // arguments of the current `rollout` call
+    struct Job {
+        const mjtNum *initialStates = nullptr;
+        int nstep = 0;
+        mjtNum *states = nullptr;
+        int nthread = 0;   // workers taking part
+    };
+
+    // worker `self` >= 1: run its part of every batch it takes part in
+    void workerLoop(int self) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv_start.wait(lock, [this, seen]() { return stop || batch != seen; });
+            if (stop) {
+                return;
+            }
+            seen = batch;
+            if (self >= job.nthread) {
+                continue;
+            }
+            Job current = job;
+            lock.unlock();
+
+            work(self, current.nthread, current.initialStates, current.nstep, current.states);
+
+            lock.lock();
+            if (--running == 0) {
+                cv_done.notify_all();
+            }
+        }
+    }
+
+    void work(int self, int nthread, const mjtNum *initialStates, int nstep, mjtNum *states) {
+        mjData *d = datas[self];
+        int r;
+        while (pop(self, r) || steal(self, nthread, r)) {
+            // reset first so that results do not depend on what the thread ran before
+            mj_resetData(m, d);
+            mj_setState(m, d, initialStates + static_cast<size_t>(r) * state_size_, mjSTATE_INTEGRATION);
+
+            mjtNum *out = states + static_cast<size_t>(r) * nstep * state_size_;
+            for (int t = 0; t < nstep; t++) {
+                mj_step(m, d);
+                mj_getState(m, d, out + static_cast<size_t>(t) * state_size_, mjSTATE_INTEGRATION);
+            }
+        }
+    }
+
+    bool pop(int self, int &r) {
+        auto &q = queues[self];
+        std::lock_guard<std::mutex> lockGuard(q.mtx);
+        if (q.items.empty()) {
+            return false;
+        }
+        r = q.items.front();
+        q.items.pop_front();
+        return true;
+    }
+
+    bool steal(int self, int nthread, int &r) {
+        for (int k = 1; k < nthread; k++) {
+            auto &q = queues[(self + k) % nthread];
+            std::lock_guard<std::mutex> lockGuard(q.mtx);
+            if (!q.items.empty()) {
+                r = q.items.back();
+                q.items.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    const mjModel *m;
+    int state_size_ = 0;
+
+    std::vector<mjData *> datas;     // one per thread
+    std::vector<WorkQueue> queues;   // one per thread
+
+    std::vector<std::thread> workers;   // workers 1..n-1
+    std::mutex mtx;
+    std::condition_variable cv_start;
+    std::condition_variable cv_done;
+    Job job;
+    uint64_t batch = 0;   // incremented by every `rollout` call
+    int running = 0;      // workers of the current batch still working
+    bool stop = false;
+};
+
+#endif //QMUJOCOSIM_ROLLOUT_ENGINE_HPP
@@ -0,0 +1,97 @@
+#ifndef QMUJOCOSIM_SCENE_CAPACITY_HPP
+#define QMUJOCOSIM_SCENE_CAPACITY_HPP
+
+#include <algorithm>
+
+#include <mujoco/mujoco.h>
+
+
+/**
+ * Sizing of `mjvScene::maxgeom`.
+ *
+ * `mjv_updateScene` silently drops everything past `maxgeom`, so the capacity is estimated from the element counts
+ * of the model and the decorations enabled in `opt`. Contacts are not known in advance and get a fixed reserve;
+ * renderers grow the scene with `grownSceneCapacity` when it fills up anyway.
+ */
+static constexpr int MIN_SCENE_GEOM = 256;
+static constexpr int MAX_SCENE_GEOM = 1 << 24;
+static constexpr int CONTACT_GEOM_RESERVE = 512;   // contact points, forces and island boxes
+static constexpr int SCENE_SHRINK_FACTOR = 4;      // keep a larger scene on reload unless it is this much too large
+
+inline int estimateSceneCapacity(const mjModel *m, const mjvOption *opt) {
+    if (m == nullptr) {
+        return MIN_SCENE_GEOM;
+    }
+
+    long n = m->ngeom + m->nsite + m->nskin;
+    auto enabled = [opt](int flag) { return opt == nullptr || opt->flags[flag]; };
+
+    // one capsule per tendon segment
+    if (enabled(mjVIS_TENDON)) {
+        n += m->ntendon + m->nwrap;
+    }
+    if (enabled(mjVIS_JOINT)) {
+        n += m->njnt;
+    }
+    if (enabled(mjVIS_ACTUATOR)) {
+        n += m->nu;
+    }
+    if (enabled(mjVIS_CAMERA)) {
+        n += m->ncam;
+    }
+    if (enabled(mjVIS_LIGHT)) {
+        n += m->nlight;
+    }
+    if (enabled(mjVIS_RANGEFINDER)) {
+        n += m->nsensor;
+    }
+    if (enabled(mjVIS_INERTIA)) {
+        n += m->nbody;
+    }
+    if (enabled(mjVIS_COM) || enabled(mjVIS_AUTOCONNECT)) {
+        n += 2 * m->nbody;
+    }
+    if (enabled(mjVIS_CONSTRAINT)) {
+        n += 2 * m->neq;
+    }
+    if (enabled(mjVIS_FLEXVERT)) {
+        n += m->nflexvert;
+    }
+    if (enabled(mjVIS_FLEXEDGE)) {
+        n += m->nflexedge;
+    }
+    if (enabled(mjVIS_BODYBVH) || enabled(mjVIS_MESHBVH) || enabled(mjVIS_FLEXBVH)) {
+        n += m->nbvh;
+    }
+
+    // three arrows per frame
+    if (opt != nullptr && opt->frame != mjFRAME_NONE) {
+        n += 3 * static_cast<long>(std::max({m->nbody, m->ngeom, m->nsite, m->ncam, m->nlight}));
+    }
+
+    n += CONTACT_GEOM_RESERVE;
+    n += n / 4;   // headroom for perturbation and selection decorations
+    return static_cast<int>(std::clamp<long>(n, MIN_SCENE_GEOM, static_cast<long>(MAX_SCENE_GEOM)));
+}
+
+/**
+ * Capacity for a scene about to be rebuilt for `m`: the estimate, or the current capacity if that is larger
+ * but not wastefully so. This keeps a scene that had to grow for one model from growing again on every reload.
+ */
+inline int sceneCapacityForModel(const mjModel *m, const mjvOption *opt, int current) {
+    int needed = estimateSceneCapacity(m, opt);
+    if (current >= needed && current <= SCENE_SHRINK_FACTOR * needed) {
+        return current;
+    }
+    return needed;
+}
+
+// capacity after `mjv_updateScene` filled the scene: doubled, or unchanged if there was room
+inline int grownSceneCapacity(const mjvScene &scn) {
+    if (scn.ngeom < scn.maxgeom) {
+        return scn.maxgeom;
+    }
+    return std::min(2 * std::max(scn.maxgeom, MIN_SCENE_GEOM), MAX_SCENE_GEOM);
+}
+
+#endif //QMUJOCOSIM_SCENE_CAPACITY_HPP
@@ -0,0 +1,171 @@
+#ifndef QMUJOCOSIM_SCRUB_SERVICE_HPP
+#define QMUJOCOSIM_SCRUB_SERVICE_HPP
+
+#include <functional>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include <mujoco/mujoco.h>
+
+#include "trace_recorder.hpp"
+
+
+/**
+ * Runs scrub requests on a background thread, latest request wins.
+ *
+ * Requests that arrive while a job is running replace each other; the running job is told to stop through
+ * its `cancelled` predicate, after which the newest request is processed.
+ */
+class ScrubService {
+public:
+    using Job = std::function<void(int request, const std::function<bool()> &cancelled)>;
+
+    explicit ScrubService(Job job) : job(std::move(job)) {
+        worker = std::thread([this]() { run(); });
+    }
+
+    ~ScrubService() {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            stop = true;
+            pending.reset();
+            generation++;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    ScrubService(const ScrubService &) = delete;
+
+    ScrubService &operator=(const ScrubService &) = delete;
+
+    void request(int value) {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            pending = value;
+            generation++;
+        }
+        cv.notify_all();
+    }
+
+    // drop the pending request and ask the running job to stop
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            pending.reset();
+            generation++;
+        }
+    }
+
+    // block until no job is running or pending
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]() { return !busy && !pending; });
+    }
+
+private:
+    void run() {
+        TraceRecorder::instance().nameThread("scrub");
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this]() { return stop || pending.has_value(); });
+            if (stop) {
+                return;
+            }
+
+            int value = *pending;
+            pending.reset();
+            busy = true;
+            uint64_t started = generation.load();
+            lock.unlock();
+
+            job(value, [this, started]() { return generation.load(std::memory_order_relaxed) != started; });
+
+            lock.lock();
+            busy = false;
+            cv.notify_all();
+        }
+    }
+
+    Job job;
+
+    std::thread worker;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::optional<int> pending;
+    bool busy = false;
+    bool stop = false;
+    std::atomic<uint64_t> generation = 0;   // bumped under `mtx` by every request and cancellation
+};
+
+
+/**
+ * Small LRU cache of `mjData` after `mj_forward`, keyed by history frame number.
+ */
+class ForwardCache {
+public:
+    static constexpr int kCapacity = 16;
+
+    ForwardCache() = default;
+
+    ~ForwardCache() {
+        clear();
+    }
+
+    ForwardCache(const ForwardCache &) = delete;
+
+    ForwardCache &operator=(const ForwardCache &) = delete;
+
+    const mjData *find(long long frame) {
+        for (auto &entry: entries) {
+            if (entry.frame == frame) {
+                entry.lastUse = ++clock;
+                return entry.data;
+            }
+        }
+        return nullptr;
+    }
+
+    const mjData *insert(long long frame, const mjModel *m, const mjData *d) {
+        Entry *target;
+        if (entries.size() < kCapacity) {
+            entries.push_back({-1, mj_makeData(m), 0});
+            target = &entries.back();
+        } else {
+            target = &entries.front();
+            for (auto &entry: entries) {
+                if (entry.lastUse < target->lastUse) {
+                    target = &entry;
+                }
+            }
+        }
+        mj_copyData(target->data, m, d);
+        target->frame = frame;
+        target->lastUse = ++clock;
+        return target->data;
+    }
+
+    void clear() {
+        for (auto &entry: entries) {
+            mj_deleteData(entry.data);
+        }
+        entries.clear();
+    }
+
+private:
+    struct Entry {
+        long long frame;
+        mjData *data;
+        uint64_t lastUse;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t clock = 0;
+};
+
+#endif //QMUJOCOSIM_SCRUB_SERVICE_HPP
@@ -9,16 +9,35 @@
 #include <condition_variable>
 #include <cassert>
 #include <functional>
+#include <vector>
 
 #include <mujoco/mujoco.h>
 
 
 #include "utils.h"
 #include "history_buffer.hpp"
+#include "triple_buffer.hpp"
+#include "pacing_scheduler.hpp"
+#include "scrub_service.hpp"
+#include "frame_capture.hpp"
+#include "step_latency.hpp"
+#include "telemetry_sink.hpp"
+#include "trace_recorder.hpp"
+#include "lock_stats.hpp"
+#include "realtime_stats.hpp"
 
 
 constexpr double syncMisalign = 0.1;
 
+// upper bound on a single pacing wait, so pause and termination stay responsive at large slowdowns
+constexpr std::chrono::milliseconds maxPacingWait{10};
+
+// pause between iterations behind schedule, so threads waiting for `mtx` get it (std::mutex is not fair)
+constexpr std::chrono::microseconds behindScheduleSleep{50};
+
+// smoothing factor of the step time averages
+constexpr double stepTimeSmoothing = 0.05;
+
 
 class SimulationWorker {
 public:
@@ -27,36 +46,58 @@ public:
             isSimulationPaused(false),
             terminateRequested(false),
             m(model),
-            d(data) {}
+            d(data) {
+        if (m != nullptr && d != nullptr) {
+            allocateRenderSnapshots();
+        }
+    }
 
     ~SimulationWorker() {
         // Signal for simulation to terminate
         terminateSimulation();
 
+        stopScrubbing();
+
         // Proceed with cleanup
-        std::lock_guard<std::mutex> lock(mtx); // Ensure exclusive access during cleanup
+        TimedLock lockGuard(mtx, lockStats, LockStats::REPLACE); // Ensure exclusive access during cleanup
         cleanup();
+        if (threadPool) {
+            mju_threadPoolDestroy(threadPool);
+        }
     }
 
     void startSimulationLoop() {
         terminateRequested = false;
         std::cout << "Simulation loop starts." << std::endl;
 
+        PacingScheduler::configureCurrentThread();
+        TraceRecorder::instance().nameThread("simulation");
+
         // CPU-sim synchronization point
-        auto syncCPU = std::chrono::high_resolution_clock::now();
+        auto syncCPU = PacingScheduler::Clock::now();
         mjtNum syncSim = 0;
 
 
         while (!terminateRequested.load()) {
             double elapsedSim;
+            PacingScheduler::Clock::time_point deadline;
 
             // Check if the simulation should be paused and wait if so
             {
-                std::unique_lock<std::mutex> lock(mtx);
-                cv_pause.wait(lock, [&] { return !isSimulationPaused; });
+                TimedLock lock(mtx, lockStats, LockStats::SIMULATION_LOOP);
+                if (isSimulationPaused) {
+                    cv_pause.wait(lock.get(), [&] { return !isSimulationPaused; });
+                    lock.restartHold(); // the mutex was released while paused
+                    realtimeStats.paused();
+
+                    // the wall time spent paused is not drift: start over like the first iteration
+                    syncCPU = PacingScheduler::Clock::time_point();
+                }
+                TraceSpan iterationSpan("simulation loop", "simulation");
 
                 // Record CPU time at the start of the iteration
-                const auto startCPU = std::chrono::high_resolution_clock::now();
+                const auto startCPU = PacingScheduler::Clock::now();
+                realtimeStats.iteration(startCPU, d->time);
 
                 // Elapsed CPU and simulation time since last sync
                 const auto elapsedCPU = startCPU - syncCPU;
@@ -71,19 +112,24 @@ public:
 
                 // Out-of-sync (for any reason): reset sync times, step
                 if (elapsedSim < 0 || elapsedCPU.count() < 0 || syncCPU.time_since_epoch().count() == 0 || misaligned) {
+                    // only drift counts, not the first iteration or a reset
+                    if (misaligned && elapsedSim >= 0 && syncCPU.time_since_epoch().count() != 0) {
+                        realtimeStats.resync();
+                    }
+
                     // Re-sync
                     syncCPU = startCPU;
                     syncSim = d->time;
 
                     // Run single step
-                    mj_step(m, d);
+                    step();
                     stepped = true;
                 } else {
                     bool firstStep = true;
 
                     // In-sync: step until ahead of CPU
                     while (std::chrono::duration<double>(elapsedCPU).count() / slowdown > elapsedSim) {
-                        mj_step(m, d);
+                        step();
                         stepped = true;
 
                         // Update elapsed simulation time
@@ -100,16 +146,25 @@ public:
                 }
 
                 if (stepped) {
-                    historyBuffer.addToHistory(m, d);
+                    publishRenderSnapshot();
                 }
 
+                // The next step is due once the CPU time elapsed since the sync point catches up with the simulation
+                deadline = syncCPU + std::chrono::duration_cast<PacingScheduler::Clock::duration>(
+                        std::chrono::duration<double>((d->time - syncSim) * slowdown));
+                realtimeStats.finished(deadline, PacingScheduler::Clock::now());
             }
 
-            // Sleep or yield to maintain pace with real-time
-            if (busyWait) {
-                std::this_thread::yield();
-            } else { // If not busy waiting
-                std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Adjust as needed for your application
+            // Sleep (or spin, if busy waiting) until the next step is due
+            deadline = std::min(deadline, PacingScheduler::Clock::now() + maxPacingWait);
+            TraceSpan waitSpan("pacing wait", "simulation");
+            if (!pacingScheduler.wait(deadline, busyWait)) {
+                // behind schedule, nothing was waited for
+                if (busyWait) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(behindScheduleSleep);
+                }
             }
 
         }
@@ -123,34 +178,67 @@ public:
     }
 
     void setSimulationPaused(bool pause) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::SET_PAUSED);
         isSimulationPaused = pause;
         std::cout << "Pause: " << pause << std::endl;
         if (!pause) {
+            scrubService.cancel();
             historyBuffer.setScrubIndex(0);
             cv_pause.notify_one();
         }
     }
 
     void resetSimulation() {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        // a scrub finishing after this would overwrite the reset state
+        stopScrubbing();
+
+        TimedLock lockGuard(mtx, lockStats, LockStats::RESET);
         mj_resetData(m, d);
         mj_forward(m, d);
         historyBuffer.setScrubIndex(0);
+        historyBuffer.markDiscontinuity();
+        publishRenderSnapshot();
     }
 
     void makeContext(mjrContext *con) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
         mjr_makeContext(m, con, mjFONTSCALE_100);
     }
 
+    // reallocate `scn` for the current model with room for `maxgeom` geoms; resets the scene's flags
+    void makeScene(mjvScene *scn, int maxgeom) {
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
+        mjv_makeScene(m, scn, maxgeom);
+    }
+
+    /**
+     * Build the scene from the latest published render snapshot. This never takes `mtx`, so rendering does not
+     * wait on physics. Must be called from the thread that calls `replace` and `close`.
+     */
     void updateScene(mjvOption *opt, mjvPerturb *pert, mjvCamera *cam, mjvScene *scn) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
-        mjv_updateScene(m, d, opt, pert, cam, mjCAT_ALL, scn);
+        TraceSpan span("updateScene", "render");
+        renderSnapshots.update();
+        mjData *snapshot = renderSnapshots.readBuffer();
+        if (m == nullptr || snapshot == nullptr) {
+            return;
+        }
+        mjv_updateScene(m, snapshot, opt, pert, cam, mjCAT_ALL, scn);
+    }
+
+    /**
+     * Recompute only the camera of `scn` for `cam`, from the snapshot of the last `updateScene`. Views of the same
+     * state from several cameras share one `updateScene` this way.
+     */
+    void updateCamera(mjvCamera *cam, mjvScene *scn) {
+        mjData *snapshot = renderSnapshots.readBuffer();
+        if (m == nullptr || snapshot == nullptr) {
+            return;
+        }
+        mjv_updateCamera(m, snapshot, cam, scn);
     }
 
     bool isModelDataNull() {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::IS_MODEL_DATA_NULL);
         return m == nullptr || d == nullptr;
     }
 
@@ -158,23 +246,39 @@ public:
     bool isPaused() const { return isSimulationPaused; }
 
     void replace(mjModel *newModel) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        stopScrubbing();
+
+        TimedLock lockGuard(mtx, lockStats, LockStats::REPLACE);
         cleanup();
         m = newModel;
         d = mj_makeData(m);
+        scrubData = mj_makeData(m);
+
+        // the previous model's step times say nothing about this one
+        serialStepTime = 0;
+        parallelStepTime = 0;
+        configurePhysics();
 
         mj_forward(m, d);
+        if (threadPool) {
+            measureSerialStepTime();
+        }
 
         historyBuffer.initialize(m, d);
+
+        allocateRenderSnapshots();
     }
 
     void close() {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        stopScrubbing();
+
+        TimedLock lockGuard(mtx, lockStats, LockStats::REPLACE);
         cleanup();
     }
 
+    // mj_saveLastXML writes the XML parsed last, updated from `m`
     void save_xml(const std::string &filename) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::FILE_IO);
         if (m == nullptr) {
             std::cout << "Skipping save operation: 'm' is not initialized (nullptr)." << std::endl;
             return;
@@ -186,7 +290,7 @@ public:
     }
 
     void save_mjb(const std::string &filename) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::FILE_IO);
         if (m == nullptr) {
             std::cout << "Skipping save operation: 'm' is not initialized (nullptr)." << std::endl;
             return;
@@ -195,7 +299,7 @@ public:
     }
 
     void print_model(const std::string &filename) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::FILE_IO);
         if (m == nullptr) {
             std::cout << "Skipping print operation: 'm' is not initialized (nullptr)." << std::endl;
             return;
@@ -204,7 +308,7 @@ public:
     }
 
     void print_data(const std::string &filename) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::FILE_IO);
         if (m == nullptr || d == nullptr) {
             std::cout << "Skipping print operation: 'm' is not initialized (nullptr)." << std::endl;
             return;
@@ -214,7 +318,7 @@ public:
 
 
     void moveCamera(mjtMouse action, mjtNum relative_delta_x, mjtNum relative_delta_y, mjvScene *scn, mjvCamera *cam) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::MOVE_CAMERA);
         if (m == nullptr) {
             return;
         }
@@ -242,35 +346,151 @@ public:
         return busyWait;
     }
 
+    PacingStatistics getPacingStatistics() const {
+        return pacingScheduler.statistics();
+    }
+
+    void resetPacingStatistics() {
+        pacingScheduler.resetStatistics();
+    }
+
+    /**
+     * Rolling real-time factor, re-synchronizations, deadline misses and the longest stall of the simulation
+     * loop; unlike `getMeasuredSlowDown`, which samples one step per in-sync batch.
+     */
+    RealtimeStatistics getRealtimeStatistics() const {
+        return realtimeStats.statistics();
+    }
+
+    void resetRealtimeStatistics() {
+        realtimeStats.resetStatistics();
+    }
+
+
+    /**
+     * Step with a MuJoCo thread pool of `nworker` threads (0: single-threaded) and, if `islands` is set,
+     * solve the constraints of independent kinematic trees (islands) separately, so that scenes made of many
+     * unconnected bodies can spread over the workers.
+     */
+    void setPhysicsThreads(int nworker, bool islands) {
+        // the scrub thread steps `m` without `mtx`, so it may not see the options change
+        stopScrubbing();
+
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
+        if (nworker != physicsThreads) {
+            if (d) {
+                unbindThreadPool();
+            }
+            if (threadPool) {
+                mju_threadPoolDestroy(threadPool);
+                threadPool = nullptr;
+            }
+            physicsThreads = std::max(0, nworker);
+            if (physicsThreads > 0) {
+                threadPool = mju_threadPoolCreate(physicsThreads);
+            }
+            parallelStepTime = 0;
+        }
+        islandSolver = islands;
+        if (m && d) {
+            configurePhysics();
+        }
+    }
+
+    int getPhysicsThreads() const {
+        return physicsThreads;
+    }
+
+    /**
+     * Wall time of one step without and with the thread pool, averaged over recent steps (0: not measured yet).
+     * The single-threaded time is the one measured last, before the pool was enabled for the current model, or
+     * on a scratch copy of the state when the model was loaded with the pool enabled.
+     */
+    double getSerialStepTime() const {
+        return serialStepTime;
+    }
+
+    double getParallelStepTime() const {
+        return parallelStepTime;
+    }
+
+    // single-threaded step time over threaded step time, 0 while either has not been measured
+    double getPhysicsSpeedup() const {
+        double serial = serialStepTime;
+        double parallel = parallelStepTime;
+        return serial > 0 && parallel > 0 ? serial / parallel : 0;
+    }
+
+    /**
+     * Offer every stepped state to `capture` (nullptr: stop). Once this returns, the previous capture is no longer
+     * used by the simulation thread.
+     */
+    void setFrameCapture(FrameCapture *capture) {
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
+        frameCapture = capture;
+    }
+
+    /**
+     * Called whenever a new render snapshot is published, from whichever thread published it (usually the
+     * simulation thread, with `mtx` held). Must be cheap and thread-safe. Set before the simulation starts.
+     */
+    void setSnapshotCallback(std::function<void()> callback) {
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
+        snapshotCallback = std::move(callback);
+    }
 
     int getHistoryBufferSize() const {
         return historyBuffer.size();
     }
 
 
+    // number of history frames that can currently be scrubbed
+    int getHistoryBufferAvailable() const {
+        return historyBuffer.available();
+    }
+
     int getHistoryBufferScrubIndex() const {
         return historyBuffer.getScrubIndex();
     }
 
+    /**
+     * Store history frames with `mantissaBits` mantissa bits (52 is lossless); see `StateCodec`.
+     */
+    void setHistoryQuantization(int mantissaBits) {
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
+        historyBuffer.setQuantization(mantissaBits);
+    }
+
+    /**
+     * Keep the history of the next loaded model in a memory-mapped file in `directory` (0 bytes: in memory).
+     */
+    void setHistoryFile(const std::string &directory, size_t maxBytes) {
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
+        historyBuffer.setBackingFile(directory, maxBytes);
+    }
+
+    /**
+     * Pause and show the history frame at `scrub_index`. The frame is loaded asynchronously; requests that
+     * arrive while one is being loaded are coalesced, so only the latest one is shown.
+     */
     void setScrubIndex(int scrub_index) {
         setSimulationPaused(true);
         historyBuffer.setScrubIndex(scrub_index);
-        {
-            std::lock_guard<std::mutex> lockGuard(mtx);
-            historyBuffer.loadScrubState(m, d);
-        }
+        scrubService.request(scrub_index);
     }
 
 
     void stepForward() {
         assert(isPaused());
-        std::lock_guard<std::mutex> lockGuard(mtx);
-        mj_step(m, d);
-        historyBuffer.addToHistory(m, d);
+        stopScrubbing(); // a scrub finishing after this would overwrite the step
+
+        TimedLock lockGuard(mtx, lockStats, LockStats::STEP_FORWARD);
+        step();
+        publishRenderSnapshot();
     }
 
     bool accessModelAndData(std::function<void(mjModel *m, mjData *d)> func) {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::ACCESS_MODEL_AND_DATA);
         if (m == nullptr || d == nullptr) {
             return false;
         }
@@ -278,8 +498,42 @@ public:
         return true;
     }
 
+    /**
+     * Timer breakdown of every step. Steps are recorded under `mtx`; `collect` and the statistics belong to a
+     * single consumer thread (the GUI).
+     */
+    StepLatency &getStepLatency() {
+        return stepLatency;
+    }
+
+    /**
+     * Stream every step to rotating files in `directory` (empty: stop), see `TelemetrySink`.
+     * @return false if the telemetry file could not be created
+     */
+    bool setTelemetry(const std::string &directory, TelemetrySink::Format format, uintmax_t maxFileBytes,
+                      int maxFiles) {
+        TimedLock lockGuard(mtx, lockStats, LockStats::CONFIGURE);
+        if (directory.empty()) {
+            telemetry.close();
+            return true;
+        }
+        return telemetry.open(directory, format, maxFileBytes, maxFiles);
+    }
+
+    const TelemetrySink &getTelemetry() const {
+        return telemetry;
+    }
+
+    /**
+     * Wait and hold times of `mtx` per call site. The simulation loop's wait time is the time the other threads
+     * stall physics.
+     */
+    LockStats &getLockStats() {
+        return lockStats;
+    }
+
     void clearDataTimers() {
-        std::lock_guard<std::mutex> lockGuard(mtx);
+        TimedLock lockGuard(mtx, lockStats, LockStats::CLEAR_DATA_TIMERS);
         if (d == nullptr) {
             return;
         }
@@ -287,7 +541,151 @@ public:
     }
 
 private:
+    /**
+     * mj_step, timed for the speedup estimate and the latency distribution, and recorded as one history frame:
+     * the history re-simulates missing frames with one `mj_step` each. `mtx` must be held.
+     */
+    void step() {
+        StepLatency::Sample timers = StepLatency::timers(d);
+        auto start = PacingScheduler::Clock::now();
+        {
+            TraceSpan span("mj_step", "simulation");
+            mj_step(m, d);
+        }
+        timers = StepLatency::since(timers, d);
+        stepLatency.record(timers);
+        telemetry.record(d, timers);
+        double elapsed = std::chrono::duration<double>(PacingScheduler::Clock::now() - start).count();
+
+        std::atomic<double> &average = threadPool ? parallelStepTime : serialStepTime;
+        double previous = average.load(std::memory_order_relaxed);
+        average.store(previous > 0 ? previous + stepTimeSmoothing * (elapsed - previous) : elapsed,
+                      std::memory_order_relaxed);
+
+        historyBuffer.addToHistory(m, d);
+
+        if (frameCapture) {
+            frameCapture->capture(m, d);
+        }
+    }
+
+    // apply the thread pool and island settings to `m` and `d`; `mtx` must be held
+    void configurePhysics() {
+        if (islandSolver) {
+            m->opt.enableflags |= mjENBL_ISLAND;
+        } else {
+            m->opt.enableflags &= ~mjENBL_ISLAND;
+        }
+        if (threadPool && d->threadpool == 0) {
+            mju_bindThreadPool(d, threadPool);
+        }
+    }
+
+    /**
+     * mju_bindThreadPool refuses to rebind and lays out the stack of `d` for the pool's workers, so before the
+     * pool is replaced `d` is replaced by a fresh `mjData` holding the same state. `mtx` must be held.
+     */
+    void unbindThreadPool() {
+        std::vector<mjtNum> state(mj_stateSize(m, mjSTATE_INTEGRATION));
+        mj_getState(m, d, state.data(), mjSTATE_INTEGRATION);
+
+        mjData *unbound = mj_makeData(m);
+        mj_setState(m, unbound, state.data(), mjSTATE_INTEGRATION);
+        mj_deleteData(d);
+        d = unbound;
+        mj_forward(m, d);
+    }
+
+    /**
+     * Time a few single-threaded steps on `scrubData`, the only unbound `mjData`, so the speedup has a baseline
+     * when a model is loaded with the pool already enabled. `mtx` must be held and scrubbing stopped.
+     */
+    void measureSerialStepTime() {
+        constexpr int kSteps = 16;
+        constexpr double kMaxSeconds = 0.05;
+
+        std::vector<mjtNum> state(mj_stateSize(m, mjSTATE_INTEGRATION));
+        mj_getState(m, d, state.data(), mjSTATE_INTEGRATION);
+        mj_setState(m, scrubData, state.data(), mjSTATE_INTEGRATION);
+
+        auto start = PacingScheduler::Clock::now();
+        double elapsed = 0;
+        int n = 0;
+        while (n < kSteps && elapsed < kMaxSeconds) {
+            mj_step(m, scrubData);
+            n++;
+            elapsed = std::chrono::duration<double>(PacingScheduler::Clock::now() - start).count();
+        }
+        serialStepTime = elapsed / n;
+    }
+
+    // runs on the scrub service thread; `replace`, `close` and the destructor wait for it before touching `m`
+    void scrub(int scrubIndex, const std::function<bool()> &cancelled) {
+        TraceSpan span("scrub", "scrub");
+        if (scrubData == nullptr) {
+            return;
+        }
+
+        long long frame = historyBuffer.scrubFrame(scrubIndex);
+        const mjData *result = forwardCache.find(frame);
+        if (result == nullptr) {
+            TraceSpan loadSpan("loadFrame", "scrub");
+            if (!historyBuffer.loadFrame(m, scrubData, frame, cancelled)) {
+                return;
+            }
+            result = forwardCache.insert(frame, m, scrubData);
+        }
+
+        TimedLock lockGuard(mtx, lockStats, LockStats::SCRUB);
+        if (!isSimulationPaused || cancelled()) {
+            return;
+        }
+        uintptr_t pool = d->threadpool;
+        mj_copyData(d, m, result);
+        d->threadpool = pool;   // the cached copy is not bound to the pool
+        historyBuffer.markDiscontinuity();
+        publishRenderSnapshot();
+    }
+
+    void stopScrubbing() {
+        scrubService.cancel();
+        scrubService.wait();
+    }
+
+    void allocateRenderSnapshots() {
+        renderSnapshots.reset();
+        for (auto &snapshot: renderSnapshots.raw()) {
+            snapshot = mj_makeData(m);
+        }
+        publishRenderSnapshot();
+    }
+
+    // copy the current state into the render triple buffer; `mtx` must be held
+    void publishRenderSnapshot() {
+        TraceSpan span("publishRenderSnapshot", "simulation");
+        mjData *snapshot = renderSnapshots.writeBuffer();
+        if (snapshot == nullptr) {
+            return;
+        }
+        mj_copyData(snapshot, m, d);
+        renderSnapshots.publish();
+        if (snapshotCallback) {
+            snapshotCallback();
+        }
+    }
+
     void cleanup() {
+        forwardCache.clear();
+        if (scrubData) {
+            mj_deleteData(scrubData);
+            scrubData = nullptr;
+        }
+        for (auto &snapshot: renderSnapshots.raw()) {
+            if (snapshot) {
+                mj_deleteData(snapshot);
+                snapshot = nullptr;
+            }
+        }
         if (d) {
             mj_deleteData(d);
             d = nullptr;
@@ -307,14 +705,40 @@ private:
 
     std::mutex mtx;
     std::condition_variable cv_pause;
+    LockStats lockStats; // contention on `mtx`, per call site
 
 
     std::atomic<double> slowdown = 1.0;
     std::atomic<double> measured_slowdown = 1.0;
     std::atomic_bool busyWait = false;
+    PacingScheduler pacingScheduler;
+    RealtimeStats realtimeStats;
+
+    // video capture, paced in simulation time
+    FrameCapture *frameCapture = nullptr;
+
+    // multi-threaded physics; the pool outlives models and is bound to each new `d`
+    mjThreadPool *threadPool = nullptr;
+    std::atomic_int physicsThreads = 0;
+    std::atomic_bool islandSolver = false;
+    std::atomic<double> serialStepTime = 0;
+    std::atomic<double> parallelStepTime = 0;
+    StepLatency stepLatency;
+    TelemetrySink telemetry;
 
 
     HistoryBuffer historyBuffer;
+
+    // copies of `d` published by the simulation thread and consumed by `updateScene`
+    TripleBuffer<mjData *> renderSnapshots;
+    std::function<void()> snapshotCallback;
+
+    // scrubbing: scratch data for loading history frames off the GUI thread, and recently loaded frames
+    mjData *scrubData = nullptr;
+    ForwardCache forwardCache;
+    ScrubService scrubService{[this](int scrubIndex, const std::function<bool()> &cancelled) {
+        scrub(scrubIndex, cancelled);
+    }};
 };
 
 #endif //QMUJOCOSIM_SIMULATION_WORKER_HPP
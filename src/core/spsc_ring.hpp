@@ -0,0 +1,112 @@
+#ifndef QMUJOCOSIM_SPSC_RING_HPP
+#define QMUJOCOSIM_SPSC_RING_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+
+/**
+ * Preallocated lock-free ring for one producer and one consumer.
+ *
+ * Every entry is an array of `width` elements, so variable-size records such as mjData states fit without
+ * allocation. The producer calls `beginWrite`/`endWrite`, the consumer `beginRead`/`endRead`; both return
+ * nullptr instead of blocking when the ring is full or empty.
+ */
+template<typename T>
+class SpscRing {
+public:
+    SpscRing() = default;
+
+    SpscRing(const SpscRing &) = delete;
+
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /**
+     * (Re)allocate and drop all entries. Not thread-safe: neither side may be active.
+     */
+    void resize(size_t capacity, size_t width = 1) {
+        capacity_ = capacity;
+        width_ = width;
+        data_.assign(capacity_ * width_, T{});
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    size_t width() const {
+        return width_;
+    }
+
+    // producer side
+
+    T *beginWrite() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (capacity_ == 0 || head - tail_.load(std::memory_order_acquire) == capacity_) {
+            return nullptr;
+        }
+        return &data_[(head % capacity_) * width_];
+    }
+
+    void endWrite() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T &value) {
+        T *entry = beginWrite();
+        if (entry == nullptr) {
+            return false;
+        }
+        *entry = value;
+        endWrite();
+        return true;
+    }
+
+    // consumer side
+
+    T *beginRead() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) {
+            return nullptr;
+        }
+        return &data_[(tail % capacity_) * width_];
+    }
+
+    void endRead() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(T &value) {
+        T *entry = beginRead();
+        if (entry == nullptr) {
+            return false;
+        }
+        value = *entry;
+        endRead();
+        return true;
+    }
+
+    // either side
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return head_.load(std::memory_order_acquire) - tail;
+    }
+
+private:
+    std::vector<T> data_;
+    size_t capacity_ = 0;
+    size_t width_ = 1;
+
+    alignas(64) std::atomic<size_t> head_ = 0;   // written by the producer
+    alignas(64) std::atomic<size_t> tail_ = 0;   // written by the consumer
+};
+
+#endif //QMUJOCOSIM_SPSC_RING_HPP
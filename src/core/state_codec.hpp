@@ -0,0 +1,119 @@
+#ifndef QMUJOCOSIM_STATE_CODEC_HPP
+#define QMUJOCOSIM_STATE_CODEC_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <algorithm>
+
+#include <mujoco/mujoco.h>
+
+
+/**
+ * Byte codec for state vectors, delta-coded against a reference vector.
+ *
+ * Each value is XOR-ed bitwise with its reference; the leading and trailing zero bytes of the result are
+ * dropped. Values equal to their reference are run-length coded, so static parts of a model cost almost
+ * nothing. Optionally the mantissa is rounded to fewer bits first, which bounds the relative error by
+ * 2^-(mantissaBits + 1) and leaves more zero bytes to drop.
+ *
+ * Token layout:
+ *   1rrrrrrr                   run of r + 1 values equal to the reference
+ *   00lllttt  b0 .. b(7-l-t)   value with l leading and t trailing zero bytes, followed by the remaining bytes
+ */
+class StateCodec {
+public:
+    static constexpr int kLosslessMantissaBits = 52;
+
+    /**
+     * Round the mantissa of `value` to `mantissaBits` bits (round half up). Infinities and NaNs are unchanged.
+     */
+    static mjtNum quantize(mjtNum value, int mantissaBits) {
+        if (mantissaBits >= kLosslessMantissaBits) {
+            return value;
+        }
+        auto bits = std::bit_cast<uint64_t>(value);
+        if ((bits & kExponentMask) == kExponentMask) {
+            return value;
+        }
+        int drop = kLosslessMantissaBits - mantissaBits;
+        bits += uint64_t{1} << (drop - 1);
+        bits &= ~((uint64_t{1} << drop) - 1);
+        return std::bit_cast<mjtNum>(bits);
+    }
+
+    /**
+     * Append the encoding of `state` to `out`.
+     * @param reference previous state, or nullptr to code against zero
+     * @param reconstructed receives the values the decoder will produce (may alias `state`)
+     */
+    static void encode(const mjtNum *state, const mjtNum *reference, int n, int mantissaBits,
+                       std::vector<uint8_t> &out, mjtNum *reconstructed) {
+        int run = 0;
+        for (int i = 0; i < n; i++) {
+            mjtNum value = quantize(state[i], mantissaBits);
+            uint64_t x = std::bit_cast<uint64_t>(value) ^ referenceBits(reference, i);
+            reconstructed[i] = value;
+
+            if (x == 0) {
+                run++;
+                continue;
+            }
+            flushRun(run, out);
+
+            int lead = std::countl_zero(x) / 8;
+            int trail = std::countr_zero(x) / 8;
+            out.push_back(static_cast<uint8_t>((lead << 3) | trail));
+            for (int b = trail; b < 8 - lead; b++) {
+                out.push_back(static_cast<uint8_t>(x >> (8 * b)));
+            }
+        }
+        flushRun(run, out);
+    }
+
+    /**
+     * Decode one state written by `encode`.
+     * @return pointer past the consumed bytes
+     */
+    static const uint8_t *decode(const uint8_t *in, const mjtNum *reference, int n, mjtNum *state) {
+        int i = 0;
+        while (i < n) {
+            uint8_t token = *in++;
+            if (token & 0x80) {
+                int run = (token & 0x7f) + 1;
+                for (int k = 0; k < run; k++, i++) {
+                    state[i] = std::bit_cast<mjtNum>(referenceBits(reference, i));
+                }
+                continue;
+            }
+
+            int lead = token >> 3;
+            int trail = token & 0x7;
+            uint64_t x = 0;
+            for (int b = trail; b < 8 - lead; b++) {
+                x |= static_cast<uint64_t>(*in++) << (8 * b);
+            }
+            state[i] = std::bit_cast<mjtNum>(x ^ referenceBits(reference, i));
+            i++;
+        }
+        return in;
+    }
+
+private:
+    static constexpr uint64_t kExponentMask = 0x7ff0000000000000ull;
+
+    static uint64_t referenceBits(const mjtNum *reference, int i) {
+        return reference ? std::bit_cast<uint64_t>(reference[i]) : 0;
+    }
+
+    static void flushRun(int &run, std::vector<uint8_t> &out) {
+        while (run > 0) {
+            int r = std::min(run, 128);
+            out.push_back(static_cast<uint8_t>(0x80 | (r - 1)));
+            run -= r;
+        }
+    }
+};
+
+#endif //QMUJOCOSIM_STATE_CODEC_HPP
@@ -0,0 +1,154 @@
+#ifndef QMUJOCOSIM_STEP_LATENCY_HPP
+#define QMUJOCOSIM_STEP_LATENCY_HPP
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+#include <mujoco/mujoco.h>
+
+#include "spsc_ring.hpp"
+
+
+/**
+ * Timer breakdown of every single `mj_step`, for tail latencies that per-frame averages of `mjData::timer` hide.
+ *
+ * The simulation thread `record`s the difference of the MuJoCo timers across each step into a lock-free ring
+ * (steps are dropped, and counted, if the ring is full). The GUI `collect`s them into a rolling window of the
+ * last `window` steps, from which percentiles and histograms are computed.
+ */
+class StepLatency {
+public:
+    enum Component {
+        TOTAL,
+        COLLISION,
+        MAKE,
+        PROJECT,
+        CONSTRAINT,
+        NCOMPONENT,
+    };
+
+    using Sample = std::array<float, NCOMPONENT>;   // msec
+
+    struct Percentiles {
+        float p50 = 0;
+        float p95 = 0;
+        float p99 = 0;
+        float max = 0;
+    };
+
+    explicit StepLatency(size_t window = 4096, size_t ringSize = 16384) : window_(window) {
+        ring_.resize(ringSize);
+        samples_.reserve(window);
+    }
+
+    StepLatency(const StepLatency &) = delete;
+
+    StepLatency &operator=(const StepLatency &) = delete;
+
+    // producer side
+
+    // timers before the step, see `since`
+    static Sample timers(const mjData *d) {
+        return {
+                static_cast<float>(d->timer[mjTIMER_STEP].duration),
+                static_cast<float>(d->timer[mjTIMER_POS_COLLISION].duration),
+                static_cast<float>(d->timer[mjTIMER_POS_MAKE].duration),
+                static_cast<float>(d->timer[mjTIMER_POS_PROJECT].duration),
+                static_cast<float>(d->timer[mjTIMER_CONSTRAINT].duration),
+        };
+    }
+
+    // timers of the step that took them from `before` to the current ones of `d`
+    static Sample since(const Sample &before, const mjData *d) {
+        Sample after = timers(d);
+        Sample sample;
+        for (int i = 0; i < NCOMPONENT; i++) {
+            sample[i] = std::max(0.0f, after[i] - before[i]);
+        }
+        return sample;
+    }
+
+    void record(const Sample &sample) {
+        if (!ring_.push(sample)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // consumer side
+
+    // move the recorded steps into the window; returns the number of new steps
+    int collect() {
+        int count = 0;
+        Sample sample;
+        while (ring_.pop(sample)) {
+            if (samples_.size() < window_) {
+                samples_.push_back(sample);
+            } else {
+                samples_[next_] = sample;
+            }
+            next_ = (next_ + 1) % window_;
+            count++;
+        }
+        return count;
+    }
+
+    // forget the window, e.g. for a new model
+    void clearWindow() {
+        samples_.clear();
+        next_ = 0;
+    }
+
+    size_t size() const {
+        return samples_.size();
+    }
+
+    Percentiles percentiles(Component component = TOTAL) const {
+        Percentiles result;
+        if (samples_.empty()) {
+            return result;
+        }
+        sorted_.resize(samples_.size());
+        for (size_t i = 0; i < samples_.size(); i++) {
+            sorted_[i] = samples_[i][component];
+        }
+        std::sort(sorted_.begin(), sorted_.end());
+        auto at = [this](double q) { return sorted_[static_cast<size_t>(q * static_cast<double>(sorted_.size() - 1))]; };
+        result.p50 = at(0.50);
+        result.p95 = at(0.95);
+        result.p99 = at(0.99);
+        result.max = sorted_.back();
+        return result;
+    }
+
+    /**
+     * Step count per bin of width `binWidth` msec; the last bin also counts everything beyond it.
+     */
+    std::vector<int> histogram(Component component, int nbin, float binWidth) const {
+        std::vector<int> counts(nbin, 0);
+        for (const auto &sample: samples_) {
+            int bin = std::min(nbin - 1, static_cast<int>(sample[component] / binWidth));
+            counts[std::max(0, bin)]++;
+        }
+        return counts;
+    }
+
+    // steps lost because the consumer did not keep up
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    SpscRing<Sample> ring_;
+    std::atomic<uint64_t> dropped_ = 0;
+
+    // consumer
+    size_t window_;
+    std::vector<Sample> samples_;
+    size_t next_ = 0;
+    mutable std::vector<float> sorted_;
+};
+
+#endif //QMUJOCOSIM_STEP_LATENCY_HPP
@@ -0,0 +1,274 @@
+#ifndef QMUJOCOSIM_TELEMETRY_SINK_HPP
+#define QMUJOCOSIM_TELEMETRY_SINK_HPP
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <mujoco/mujoco.h>
+
+#include "spsc_ring.hpp"
+#include "step_latency.hpp"
+
+
+/**
+ * Streams one record per simulation step (solver statistics and the step's timer breakdown) to rotating files,
+ * for soak runs that are analysed offline instead of through the 201-point profiler figures.
+ *
+ * The simulation thread `record`s into a lock-free ring; a background thread formats and writes. Files are named
+ * `telemetry-<start time>-<n>.csv` (or `.bin`) and a new one is started every `maxFileBytes`; only the newest
+ * `maxFiles` of a session are kept. If the writer falls behind, records are dropped and counted, the step is
+ * never held up.
+ *
+ * The binary format is a header `QMJT`, uint32 version, uint32 record size, followed by little-endian records
+ * with the fields of `Record` in order (uint64, float64, 5 x int32, 5 x float32, 4 bytes padding).
+ */
+class TelemetrySink {
+public:
+    enum Format {
+        CSV,
+        BINARY,
+    };
+
+    struct Record {
+        uint64_t step = 0;     // steps recorded since `open`
+        double time = 0;       // simulation time
+        int32_t nisland = 0;
+        int32_t niter = 0;     // solver iterations, summed over islands
+        int32_t nefc = 0;
+        int32_t ncon = 0;
+        int32_t nnz = 0;       // nonzeros of the constraint Hessian, summed over islands
+        StepLatency::Sample timers = {};   // msec, see `StepLatency::Component`
+    };
+
+    static constexpr uint32_t BINARY_VERSION = 1;
+    static constexpr size_t BINARY_RECORD_SIZE = 8 + 8 + 5 * 4 + StepLatency::NCOMPONENT * 4 + 4;
+
+    TelemetrySink() = default;
+
+    ~TelemetrySink() {
+        close();
+    }
+
+    TelemetrySink(const TelemetrySink &) = delete;
+
+    TelemetrySink &operator=(const TelemetrySink &) = delete;
+
+    /**
+     * Start a new session in `directory`. The producer may not be active.
+     * @param maxFileBytes size at which the next file is started, 0: never
+     * @return false if the first file could not be created
+     */
+    bool open(const std::string &directory, Format format, uintmax_t maxFileBytes, int maxFiles = 8,
+              size_t ringSize = 65536) {
+        close();
+        directory_ = directory;
+        format_ = format;
+        maxFileBytes_ = maxFileBytes;
+        maxFiles_ = std::max(1, maxFiles);
+        fileIndex_ = 0;
+        files_.clear();
+        step_ = 0;
+        failed_ = false;
+        written_ = 0;
+        dropped_ = 0;
+
+        char stamp[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+        session_ = stamp;
+
+        if (!rotate()) {
+            return false;
+        }
+        ring_.resize(ringSize);
+        stop_ = false;
+        active_ = true;
+        writer_ = std::thread([this]() { run(); });
+        return true;
+    }
+
+    /**
+     * Write what is queued and close the file. The producer may not be active.
+     */
+    void close() {
+        if (!active_) {
+            return;
+        }
+        active_ = false;
+        stop_ = true;
+        writer_.join();
+        file_.close();
+        if (dropped_ > 0) {
+            std::cout << "Telemetry: dropped " << dropped_ << " of " << step_ << " steps" << std::endl;
+        }
+    }
+
+    bool isActive() const {
+        return active_;
+    }
+
+    // producer side
+
+    void record(const mjData *d, const StepLatency::Sample &timers) {
+        if (!active_) {
+            return;
+        }
+        Record record;
+        record.step = step_++;
+        record.time = d->time;
+        record.nisland = mjMIN(d->solver_nisland, mjNISLAND);
+        record.nefc = d->nefc;
+        record.ncon = d->ncon;
+        for (int island = 0; island < record.nisland; island++) {
+            record.niter += d->solver_niter[island];
+            record.nnz += d->solver_nnz[island];
+        }
+        record.timers = timers;
+        if (!ring_.push(record)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // statistics, from any thread
+
+    uint64_t written() const {
+        return written_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void run() {
+        Record record;
+        while (true) {
+            // read before draining: once set, the producer is stopped and this drain gets the last records
+            bool stopping = stop_;
+            bool idle = true;
+            while (ring_.pop(record)) {
+                write(record);
+                idle = false;
+            }
+            if (stopping) {
+                file_.flush();
+                return;
+            }
+            if (idle) {
+                // records are batched; the ring holds seconds of steps
+                file_.flush();
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+    }
+
+    void write(const Record &record) {
+        if (!failed_ && maxFileBytes_ > 0 && fileBytes_ >= maxFileBytes_) {
+            failed_ = !rotate();
+        }
+        if (failed_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (format_ == CSV) {
+            char line[256];
+            int length = std::snprintf(line, sizeof(line), "%llu,%.9g,%d,%d,%d,%d,%d,%.6g,%.6g,%.6g,%.6g,%.6g\n",
+                                       static_cast<unsigned long long>(record.step), record.time, record.nisland,
+                                       record.niter, record.nefc, record.ncon, record.nnz,
+                                       record.timers[StepLatency::TOTAL], record.timers[StepLatency::COLLISION],
+                                       record.timers[StepLatency::MAKE], record.timers[StepLatency::PROJECT],
+                                       record.timers[StepLatency::CONSTRAINT]);
+            file_.write(line, length);
+            fileBytes_ += length;
+        } else {
+            char bytes[BINARY_RECORD_SIZE] = {};
+            char *p = bytes;
+            auto put = [&p](const auto &value) {
+                std::memcpy(p, &value, sizeof(value));
+                p += sizeof(value);
+            };
+            put(record.step);
+            put(record.time);
+            put(record.nisland);
+            put(record.niter);
+            put(record.nefc);
+            put(record.ncon);
+            put(record.nnz);
+            for (float timer: record.timers) {
+                put(timer);
+            }
+            file_.write(bytes, sizeof(bytes));
+            fileBytes_ += sizeof(bytes);
+        }
+        written_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // start the next file of the session and delete the oldest beyond `maxFiles_`
+    bool rotate() {
+        file_.close();
+        std::filesystem::path path = std::filesystem::path(directory_) /
+                                     ("telemetry-" + session_ + "-" + std::to_string(fileIndex_++) +
+                                      (format_ == CSV ? ".csv" : ".bin"));
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_) {
+            std::cout << "Telemetry: could not create " << path << std::endl;
+            return false;
+        }
+
+        files_.push_back(path);
+        while (static_cast<int>(files_.size()) > maxFiles_) {
+            std::error_code ec;
+            std::filesystem::remove(files_.front(), ec);
+            files_.pop_front();
+        }
+
+        // every file is self-describing, so any one of them can be read on its own
+        if (format_ == CSV) {
+            static const char header[] =
+                    "step,time,nisland,niter,nefc,ncon,nnz,total,collision,make,project,constraint\n";
+            file_.write(header, sizeof(header) - 1);
+            fileBytes_ = sizeof(header) - 1;
+        } else {
+            uint32_t version = BINARY_VERSION;
+            uint32_t size = BINARY_RECORD_SIZE;
+            file_.write("QMJT", 4);
+            file_.write(reinterpret_cast<const char *>(&version), sizeof(version));
+            file_.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            fileBytes_ = 12;
+        }
+        return true;
+    }
+
+    SpscRing<Record> ring_;
+    uint64_t step_ = 0;   // producer
+    std::atomic<uint64_t> written_ = 0;
+    std::atomic<uint64_t> dropped_ = 0;
+    std::atomic_bool active_ = false;
+    std::atomic_bool stop_ = false;
+
+    // writer
+    std::thread writer_;
+    std::string directory_;
+    std::string session_;
+    Format format_ = CSV;
+    uintmax_t maxFileBytes_ = 0;
+    int maxFiles_ = 8;
+    int fileIndex_ = 0;
+    std::deque<std::filesystem::path> files_;
+    std::ofstream file_;
+    uintmax_t fileBytes_ = 0;
+    bool failed_ = false;
+};
+
+#endif //QMUJOCOSIM_TELEMETRY_SINK_HPP
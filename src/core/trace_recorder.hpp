@@ -0,0 +1,267 @@
+#ifndef QMUJOCOSIM_TRACE_RECORDER_HPP
+#define QMUJOCOSIM_TRACE_RECORDER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+
+#include "spsc_ring.hpp"
+
+
+/**
+ * Records timed spans of every thread for a cross-thread timeline, exported as Chrome trace-event JSON (open it
+ * in Perfetto or chrome://tracing).
+ *
+ * Threads put `TraceSpan`s on the stack; while recording is off a span costs one relaxed atomic load. While on,
+ * finished spans go into a lock-free ring per thread, which one consumer thread (the GUI) drains with `collect`
+ * every frame and every 50 ms while nothing is painted, and `stop` writes out. Spans beyond a full ring are
+ * dropped and counted. A thread's ring goes back to a free list when the thread exits and is reused by the next
+ * thread, and threads of the same name share one track, so threads that are recreated (simulation, video) neither
+ * leak rings nor multiply tracks. Span names and categories must be string literals.
+ */
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static TraceRecorder &instance() {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // label the calling thread in the timeline; threads of the same name share a track
+    void nameThread(const std::string &name) {
+        ThreadBuffer &buffer = threadBuffer();
+        std::lock_guard<std::mutex> lockGuard(registryMutex);
+        auto [it, inserted] = threadIds.try_emplace(name, nextThreadId);
+        if (inserted) {
+            nextThreadId++;
+        }
+        buffer.id = it->second;
+    }
+
+    // producer side, any thread
+
+    void add(const char *name, const char *category, Clock::time_point begin, Clock::time_point end) {
+        ThreadBuffer &buffer = threadBuffer();
+        if (!buffer.ring.push(Event{name, category, begin, end, buffer.id})) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // consumer side, one thread
+
+    // discard anything recorded before and start recording
+    void start() {
+        drain(nullptr);
+        events.clear();
+        dropped = 0;
+        origin = Clock::now();
+        enabled = true;
+    }
+
+    // move finished spans out of the per-thread rings
+    void collect() {
+        drain(&events);
+    }
+
+    /**
+     * Stop recording and write the trace to `path`.
+     * @return false with `error` set if the file could not be written
+     */
+    bool stop(const std::string &path, std::string &error) {
+        enabled = false;
+        collect();
+
+        std::ofstream file(path);
+        if (!file) {
+            error = "could not create " + path;
+            events.clear();
+            return false;
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        {
+            std::lock_guard<std::mutex> lockGuard(registryMutex);
+            for (const auto &[name, id]: threadIds) {
+                file << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << id
+                     << R"(,"args":{"name":")" << escape(name) << "\"}}";
+                first = false;
+            }
+        }
+        char line[256];
+        for (const auto &event: events) {
+            std::snprintf(line, sizeof(line), R"(%s{"name":"%s","cat":"%s","ph":"X","pid":1,"tid":%u,"ts":%.3f,"dur":%.3f})",
+                          first ? "" : ",\n", event.name, event.category, event.thread,
+                          microseconds(event.begin - origin), microseconds(event.end - event.begin));
+            file << line;
+            first = false;
+        }
+        file << "\n]}\n";
+        events.clear();
+
+        if (!file) {
+            error = "could not write " + path;
+            return false;
+        }
+        return true;
+    }
+
+    // spans lost to full rings or the size limit of a trace
+    uint64_t droppedSpans() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Event {
+        const char *name;
+        const char *category;
+        Clock::time_point begin;
+        Clock::time_point end;
+        uint32_t thread;    // track, so spans left in a reused ring keep their thread
+    };
+
+    struct ThreadBuffer {
+        uint32_t id = 0;    // written by the owning thread
+        bool inUse = false; // guarded by `registryMutex`
+        SpscRing<Event> ring;
+    };
+
+    // returns the calling thread's buffer to the free list when the thread exits
+    struct BufferOwner {
+        ThreadBuffer *buffer = nullptr;
+
+        ~BufferOwner() {
+            if (buffer) {
+                TraceRecorder::instance().release(buffer);
+            }
+        }
+    };
+
+    static constexpr size_t RING_SIZE = 1 << 14;          // per thread, drained at least every 50 ms
+    static constexpr size_t MAX_EVENTS = 4 * 1000 * 1000;  // per trace
+
+    TraceRecorder() = default;
+
+    // the buffer of the calling thread, taken from the free list or created on first use
+    ThreadBuffer &threadBuffer() {
+        thread_local BufferOwner owner;
+        if (owner.buffer == nullptr) {
+            owner.buffer = acquire();
+        }
+        return *owner.buffer;
+    }
+
+    ThreadBuffer *acquire() {
+        std::lock_guard<std::mutex> lockGuard(registryMutex);
+        ThreadBuffer *buffer = nullptr;
+        for (const auto &candidate: buffers) {
+            if (!candidate->inUse) {
+                buffer = candidate.get();
+                break;
+            }
+        }
+        if (buffer == nullptr) {
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->ring.resize(RING_SIZE);
+        }
+        buffer->inUse = true;
+        buffer->id = nextThreadId++; // a track of its own until named
+        return buffer;
+    }
+
+    // spans still in the ring are drained as usual, with the thread they were recorded on
+    void release(ThreadBuffer *buffer) {
+        std::lock_guard<std::mutex> lockGuard(registryMutex);
+        buffer->inUse = false;
+    }
+
+    // empty the rings into `into`, or discard them
+    void drain(std::vector<Event> *into) {
+        std::lock_guard<std::mutex> lockGuard(registryMutex);
+        for (const auto &buffer: buffers) {
+            Event event{};
+            while (buffer->ring.pop(event)) {
+                if (into == nullptr) {
+                    continue;
+                }
+                if (into->size() >= MAX_EVENTS) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                into->push_back(event);
+            }
+        }
+    }
+
+    static double microseconds(Clock::duration duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    static std::string escape(const std::string &text) {
+        std::string escaped;
+        for (char c: text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    static inline std::atomic_bool enabled = false;
+    std::atomic<uint64_t> dropped = 0;
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;   // as many as threads were alive at once
+    std::map<std::string, uint32_t> threadIds;            // named tracks
+    uint32_t nextThreadId = 1;
+
+    // consumer
+    std::vector<Event> events;
+    Clock::time_point origin;
+};
+
+
+/**
+ * Times the enclosing scope into the `TraceRecorder`, if it is recording when the scope is entered.
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name, const char *category = "app") {
+        if (TraceRecorder::isEnabled()) {
+            name_ = name;
+            category_ = category;
+            begin_ = TraceRecorder::Clock::now();
+        }
+    }
+
+    ~TraceSpan() {
+        if (name_) {
+            TraceRecorder::instance().add(name_, category_, begin_, TraceRecorder::Clock::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name_ = nullptr;
+    const char *category_ = nullptr;
+    TraceRecorder::Clock::time_point begin_;
+};
+
+#endif //QMUJOCOSIM_TRACE_RECORDER_HPP
@@ -0,0 +1,76 @@
+#ifndef QMUJOCOSIM_TRIPLE_BUFFER_HPP
+#define QMUJOCOSIM_TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+
+
+/**
+ * Lock-free triple buffer for a single producer and a single consumer.
+ *
+ * The producer fills `writeBuffer()` and calls `publish()`; the consumer calls `update()` and then reads
+ * `readBuffer()`, which always refers to the most recently published buffer. Neither side ever waits.
+ */
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer &) = delete;
+
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    /**
+     * Restore the initial buffer assignment. Not thread-safe: neither side may be active.
+     */
+    void reset() {
+        back = 0;
+        middle.store(1, std::memory_order_relaxed);
+        front = 2;
+    }
+
+    // producer side
+
+    T &writeBuffer() {
+        return buffers[back];
+    }
+
+    void publish() {
+        back = middle.exchange(back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // consumer side
+
+    /**
+     * Swap in the latest published buffer, if any.
+     * @return whether `readBuffer()` changed
+     */
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    T &readBuffer() {
+        return buffers[front];
+    }
+
+    // all three buffers, for (de)allocation while neither side is active
+    std::array<T, 3> &raw() {
+        return buffers;
+    }
+
+private:
+    static constexpr int kIndexMask = 0b11;
+    static constexpr int kFresh = 0b100;
+
+    std::array<T, 3> buffers{};
+
+    int back = 0;                  // owned by the producer
+    std::atomic_int middle = 1;    // shared, carries the fresh bit
+    int front = 2;                 // owned by the consumer
+};
+
+#endif //QMUJOCOSIM_TRIPLE_BUFFER_HPP
@@ -0,0 +1,163 @@
+#ifndef QMUJOCOSIM_VIEWPORT_LAYOUT_HPP
+#define QMUJOCOSIM_VIEWPORT_LAYOUT_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <mujoco/mujoco.h>
+
+
+/**
+ * Splits the window into 1, 2 or 4 views of the same scene, each with its own camera.
+ *
+ * View 0 is the interactive free camera. By default view 1 tracks the first body below the world and the others
+ * show the model's fixed cameras; `cycleCamera` steps a view through free, tracking and every fixed camera.
+ * All views render from one `mjvScene`: the geometry is updated once per frame and only the camera is
+ * recomputed per view (see `SimulationWorker::updateCamera`).
+ */
+class ViewportLayout {
+public:
+    enum Layout {
+        SINGLE = 1,
+        SIDE_BY_SIDE = 2,
+        GRID = 4,
+    };
+
+    struct View {
+        mjvCamera cam;
+        mjrRect rect = {0, 0, 0, 0};
+        mjvGLCamera glcam[2];   // `mjvScene::camera` of the last render, needed to move the camera with the mouse
+        std::string label;
+    };
+
+    ViewportLayout() {
+        views.resize(GRID);
+        for (auto &view: views) {
+            mjv_defaultCamera(&view.cam);
+        }
+        views[0].label = "Free";
+    }
+
+    Layout getLayout() const {
+        return layout;
+    }
+
+    // views beyond the current layout keep their cameras, so switching back restores them
+    void setLayout(Layout layout) {
+        this->layout = layout;
+        resize(width, height);
+    }
+
+    int count() const {
+        return static_cast<int>(layout);
+    }
+
+    View &view(int index) {
+        return views[index];
+    }
+
+    mjvCamera &mainCamera() {
+        return views[0].cam;
+    }
+
+    /**
+     * Give every view its default camera for a newly loaded model.
+     */
+    void assignCameras(const mjModel *m) {
+        for (auto &view: views) {
+            mjv_defaultCamera(&view.cam);
+        }
+        setCamera(m, 0, mjCAMERA_FREE, -1);
+        setCamera(m, 1, m->nbody > 1 ? mjCAMERA_TRACKING : mjCAMERA_FREE, 1);
+        for (int i = 2; i < GRID; i++) {
+            if (i - 2 < m->ncam) {
+                setCamera(m, i, mjCAMERA_FIXED, i - 2);
+            } else {
+                setCamera(m, i, mjCAMERA_FREE, -1);
+            }
+        }
+    }
+
+    /**
+     * @param id body to track, or fixed camera to look through; ignored for free cameras
+     */
+    void setCamera(const mjModel *m, int index, mjtCamera type, int id) {
+        View &view = views[index];
+        view.cam.type = type;
+        if (type == mjCAMERA_TRACKING) {
+            view.cam.trackbodyid = std::clamp(id, 0, m->nbody - 1);
+            const char *name = mj_id2name(m, mjOBJ_BODY, view.cam.trackbodyid);
+            view.label = std::string("Tracking ") + (name ? name : std::to_string(view.cam.trackbodyid));
+        } else if (type == mjCAMERA_FIXED && m->ncam > 0) {
+            view.cam.fixedcamid = std::clamp(id, 0, m->ncam - 1);
+            const char *name = mj_id2name(m, mjOBJ_CAMERA, view.cam.fixedcamid);
+            view.label = name ? name : "Camera " + std::to_string(view.cam.fixedcamid);
+        } else {
+            view.cam.type = mjCAMERA_FREE;
+            view.label = "Free";
+        }
+    }
+
+    // free -> tracking body 1 -> fixed camera 0 .. ncam-1 -> free
+    void cycleCamera(const mjModel *m, int index) {
+        const mjvCamera &cam = views[index].cam;
+        if (cam.type == mjCAMERA_FREE && m->nbody > 1) {
+            setCamera(m, index, mjCAMERA_TRACKING, 1);
+        } else if (cam.type != mjCAMERA_FIXED && m->ncam > 0) {
+            setCamera(m, index, mjCAMERA_FIXED, 0);
+        } else if (cam.type == mjCAMERA_FIXED && cam.fixedcamid + 1 < m->ncam) {
+            setCamera(m, index, mjCAMERA_FIXED, cam.fixedcamid + 1);
+        } else {
+            setCamera(m, index, mjCAMERA_FREE, -1);
+        }
+    }
+
+    /**
+     * Lay the views out over a framebuffer of `width` x `height` pixels.
+     */
+    void resize(int width, int height) {
+        this->width = width;
+        this->height = height;
+        int halfWidth = width / 2;
+        int halfHeight = height / 2;
+        switch (layout) {
+            case SINGLE:
+                views[0].rect = {0, 0, width, height};
+                break;
+            case SIDE_BY_SIDE:
+                views[0].rect = {0, 0, halfWidth, height};
+                views[1].rect = {halfWidth, 0, width - halfWidth, height};
+                break;
+            case GRID:
+                // row-major from the top left; mjrRect counts from the bottom
+                views[0].rect = {0, halfHeight, halfWidth, height - halfHeight};
+                views[1].rect = {halfWidth, halfHeight, width - halfWidth, height - halfHeight};
+                views[2].rect = {0, 0, halfWidth, halfHeight};
+                views[3].rect = {halfWidth, 0, width - halfWidth, halfHeight};
+                break;
+        }
+    }
+
+    /**
+     * @param x, y framebuffer pixels from the bottom left
+     * @return the view under the point, 0 if none
+     */
+    int viewAt(int x, int y) const {
+        for (int i = 0; i < count(); i++) {
+            const mjrRect &r = views[i].rect;
+            if (x >= r.left && x < r.left + r.width && y >= r.bottom && y < r.bottom + r.height) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+private:
+    Layout layout = SINGLE;
+    int width = 0;
+    int height = 0;
+    std::vector<View> views;
+};
+
+#endif //QMUJOCOSIM_VIEWPORT_LAYOUT_HPP
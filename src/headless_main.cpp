@@ -0,0 +1,128 @@
+/**
+ * Headless renderer: simulates a model and renders it offscreen at a fixed frame rate in simulation time.
+ *
+ * Usage: QMuJoCoSimHeadless model.xml [--frames N] [--fps F] [--width W] [--height H] [--output frames.rgb]
+ *
+ * Frames are written as raw rgb24, e.g. for `ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r F -i frames.rgb`.
+ * Without --output only the throughput is measured.
+ */
+
+#include <QGuiApplication>
+#include <QSurfaceFormat>
+#include <QFileInfo>
+
+#include <mujoco/mujoco.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include "offscreen_renderer.hpp"
+#include "utils.h"
+
+
+int main(int argc, char *argv[]) {
+    // no display needed unless the user picked a platform
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    check_mujoco_version();
+
+    QSurfaceFormat format;
+    format.setDepthBufferSize(24);
+    format.setStencilBufferSize(8);
+    format.setRenderableType(QSurfaceFormat::OpenGL);
+    format.setProfile(QSurfaceFormat::CompatibilityProfile);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QGuiApplication app(argc, argv);
+
+    std::string modelPath;
+    std::string output;
+    int frames = 300;
+    double fps = 60;
+    int width = 1280;
+    int height = 720;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (arg == "--fps" && i + 1 < argc) {
+            fps = std::atof(argv[++i]);
+        } else if (arg == "--width" && i + 1 < argc) {
+            width = std::atoi(argv[++i]);
+        } else if (arg == "--height" && i + 1 < argc) {
+            height = std::atoi(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            modelPath = arg;
+        }
+    }
+    if (modelPath.empty() || frames <= 0 || fps <= 0 || width <= 0 || height <= 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " model.xml [--frames N] [--fps F] [--width W] [--height H] [--output frames.rgb]" << std::endl;
+        return 2;
+    }
+
+    char error[1000] = "Could not load binary model";
+    mjModel *m;
+    if (QFileInfo(QString::fromStdString(modelPath)).suffix().compare("mjb", Qt::CaseInsensitive) == 0) {
+        m = mj_loadModel(modelPath.c_str(), nullptr);
+    } else {
+        m = mj_loadXML(modelPath.c_str(), nullptr, error, sizeof(error));
+    }
+    if (!m) {
+        std::cerr << "Load model error: " << error << std::endl;
+        return 1;
+    }
+    mjData *d = mj_makeData(m);
+    mj_forward(m, d);
+
+    OffscreenRenderer renderer(width, height);
+    if (!renderer.initialize(m)) {
+        mj_deleteData(d);
+        mj_deleteModel(m);
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output, std::ios::binary);
+        if (!file) {
+            std::cerr << "Could not open " << output << std::endl;
+            return 1;
+        }
+    }
+
+    long long delivered = 0;
+    auto consumer = [&](PixelReadback::Frame &&frame) {
+        if (file.is_open()) {
+            file.write(reinterpret_cast<const char *>(frame.rgb.data()), static_cast<std::streamsize>(frame.rgb.size()));
+        }
+        delivered++;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        // advance to the simulation time of this frame
+        double frameTime = frame / fps;
+        while (d->time < frameTime) {
+            mj_step(m, d);
+        }
+        renderer.render(m, d, frame, consumer);
+    }
+    renderer.finish(consumer);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Rendered " << delivered << " frames (" << width << "x" << height << ") in " << elapsed
+              << " s: " << delivered / elapsed << " fps" << std::endl;
+
+    renderer.release();
+    mj_deleteData(d);
+    mj_deleteModel(m);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#ifndef QMUJOCOSIM_IMAGE_WRITER_HPP
+#define QMUJOCOSIM_IMAGE_WRITER_HPP
+
+#include <QImage>
+#include <QImageWriter>
+#include <QString>
+#include <QThread>
+#include <QtLogging>
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+#include "pixel_readback.hpp"
+
+
+/**
+ * Encodes and saves frames on background threads, so the render thread only hands over pixels.
+ *
+ * Formats are whatever `QImageWriter` supports, e.g. "png", or "exr" if the KImageFormats plugin is installed;
+ * unsupported formats fall back to PNG. At most `maxBacklog` frames wait for encoding; frames beyond that are
+ * dropped and counted, so a burst faster than the encoders cannot exhaust memory.
+ */
+class ImageWriter {
+public:
+    // called on a writer thread after every save
+    using Callback = std::function<void(const QString &path, bool ok)>;
+
+    explicit ImageWriter(int nthread = std::max(1, QThread::idealThreadCount() / 2), size_t maxBacklog = 32)
+            : maxBacklog(std::max<size_t>(1, maxBacklog)) {
+        for (int i = 0; i < nthread; i++) {
+            workers.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ImageWriter() {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+    ImageWriter(const ImageWriter &) = delete;
+
+    ImageWriter &operator=(const ImageWriter &) = delete;
+
+    void setCallback(Callback callback) {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        this->callback = std::move(callback);
+    }
+
+    /**
+     * Queue `frame` to be saved as `path` + "." + format.
+     * @return false if the backlog is full and the frame was dropped
+     */
+    bool write(PixelReadback::Frame &&frame, const QString &path, const QString &format) {
+        {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            if (jobs.size() >= maxBacklog) {
+                dropped++;
+                return false;
+            }
+            jobs.push_back({std::move(frame), path, format});
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    // number of frames waiting to be encoded
+    size_t backlog() const {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        return jobs.size();
+    }
+
+    // whether the next `write` would be dropped; lets callers skip producing the frame
+    bool isFull() const {
+        return backlog() >= maxBacklog;
+    }
+
+    // frames dropped since the last call
+    uint64_t takeDropped() {
+        return dropped.exchange(0);
+    }
+
+    // block until every queued frame has been saved
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        idle.wait(lock, [this]() { return jobs.empty() && busy == 0; });
+    }
+
+    static bool isFormatSupported(const QString &format) {
+        return QImageWriter::supportedImageFormats().contains(format.toLatin1());
+    }
+
+private:
+    struct Job {
+        PixelReadback::Frame frame;
+        QString path;
+        QString format;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this]() { return stop || !jobs.empty(); });
+            // finish the queued frames before stopping
+            if (jobs.empty()) {
+                return;
+            }
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            Callback done = callback;
+            busy++;
+            lock.unlock();
+
+            QString format = isFormatSupported(job.format) ? job.format : QString("png");
+            if (format != job.format) {
+                qWarning() << "Image format" << job.format << "is not supported, saving as png.";
+            }
+            QString path = job.path + "." + format;
+            QImage image(job.frame.rgb.data(), job.frame.width, job.frame.height, job.frame.width * 3,
+                         QImage::Format_RGB888);
+            bool ok = image.save(path, format.toLatin1().constData());
+            if (done) {
+                done(path, ok);
+            }
+
+            lock.lock();
+            busy--;
+            idle.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable idle;
+    std::deque<Job> jobs;
+    size_t maxBacklog;
+    std::atomic<uint64_t> dropped = 0;
+    Callback callback;
+    int busy = 0;   // jobs being encoded
+    bool stop = false;
+};
+
+#endif //QMUJOCOSIM_IMAGE_WRITER_HPP
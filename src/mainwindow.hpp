@@ -15,6 +15,10 @@
 #include <QIcon>
 #include <QScrollArea>
 #include <QSettings>
+#include <QDateTime>
+#include <QActionGroup>
+#include <QThread>
+#include <QProgressDialog>
 
 #include "mujoco_opengl_window.hpp"
 #include "my_window_container.hpp"
@@ -64,12 +68,29 @@ public:
         makeSimulationMenu();
 
 
-        // load
+        // load; models compile in the background, the dialog only shows up if that takes a while
+        loadProgressDialog = new QProgressDialog(this);
+        loadProgressDialog->setWindowTitle("Loading Model");
+        loadProgressDialog->setWindowModality(Qt::NonModal);
+        loadProgressDialog->setRange(0, 0); // MuJoCo does not report how far a compile is
+        loadProgressDialog->setMinimumDuration(500);
+        loadProgressDialog->reset();
+        connect(loadProgressDialog, &QProgressDialog::canceled, muJoCoOpenGlWindow,
+                &MuJoCoOpenGLWindow::cancelLoading);
+        connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::loadModelStarted, [this](const QString &filename) {
+            loadProgressDialog->setLabelText(QString("Loading %1...").arg(QFileInfo(filename).fileName()));
+            loadProgressDialog->setValue(0);
+        });
+        connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::loadModelProgress, loadProgressDialog,
+                &QProgressDialog::setLabelText);
+
         connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::loadModelSuccess, [this]() {
+            loadProgressDialog->reset();
             updateControlPanelWhenModelIsNotNull();
             actionSetEnabledWhenModelIsNotNull();
         });
         connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::loadModelFailure, [this](bool isNull) {
+            loadProgressDialog->reset();
             if (isNull) {
                 actionSetEnabledWhenModelIsNull();
                 updateControlPanelWhenModelIsNull();
@@ -78,6 +99,8 @@ public:
                 updateControlPanelWhenModelIsNotNull();
             }
         });
+        connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::loadModelCancelled, loadProgressDialog,
+                &QProgressDialog::reset);
 
 
         // History Buffer
@@ -92,38 +115,32 @@ public:
         connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::isPauseChanged, [this](bool isPaused) {
             controlPanel->simulationSection->setSliderValueNoSignal(0);
         });
+        connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::historyLengthChanged, controlPanel->simulationSection,
+                &SimulationSection::setHistoryLength);
+
+        // Screenshots are saved on a background thread, the result arrives queued
+        connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::screenshotSaved, this, [this](const QString &path, bool ok) {
+            if (ok) {
+                qDebug() << "Screenshot saved to" << QDir::toNativeSeparators(path);
+            } else if (muJoCoOpenGlWindow->isScreenshotBurstActive()) {
+                qWarning() << "The image could not be saved to" << QDir::toNativeSeparators(path);
+            } else {
+                QMessageBox::warning(this, tr("Save Error"), tr("The image could not be saved to \"%1\".")
+                        .arg(QDir::toNativeSeparators(path)));
+            }
+        });
 
 
         actionSetEnabledWhenModelIsNull();
         updateControlPanelWhenModelIsNull();
+
+        applySettings();
     }
 
 private slots:
 
     void shootScreen() {
-        QScreen *screen = QGuiApplication::primaryScreen();
-        QPixmap pixmap = screen->grabWindow(muJoCoOpenGlWindow->winId());
-
-
-        auto dirPath = settings.value("screenshot_directory",
-                                      QDir::currentPath()).toString();
-
-
-        auto dir = QDir(dirPath);
-
-        // Get current date and time
-        QDateTime now = QDateTime::currentDateTime();
-        // Format date and time to string with desired format
-        QString dateTimeString = now.toString("yyyy_MM_dd_hh_mm_ss_zzz");
-
-        // Append formatted date and time to filename
-        auto path = dir.filePath(QString("screenshot_%1.png").arg(dateTimeString));
-        if (!pixmap.save(path)) {
-            QMessageBox::warning(this, tr("Save Error"), tr("The image could not be saved to \"%1\".")
-                    .arg(QDir::toNativeSeparators(path)));
-        } else {
-            qDebug() << "Screenshot saved to" << QDir::toNativeSeparators(path);
-        }
+        muJoCoOpenGlWindow->takeScreenshot();
     };
 
 
@@ -157,6 +174,37 @@ private:
             shootScreen();
         });
 
+        burstScreenshotAction = new QAction("Burst Screenshots", this);
+        burstScreenshotAction->setCheckable(true);
+        connect(burstScreenshotAction, &QAction::triggered, [this](bool checked) {
+            auto interval = settings.value("screenshot_burst_interval", 10).toInt();
+            muJoCoOpenGlWindow->setScreenshotBurst(checked ? interval : 0);
+        });
+
+        recordVideoAction = new QAction("Record Video", this);
+        recordVideoAction->setCheckable(true);
+        connect(recordVideoAction, &QAction::triggered, [this](bool checked) {
+            if (!checked) {
+                muJoCoOpenGlWindow->stopRecording();
+                return;
+            }
+            auto dir = QDir(settings.value("screenshot_directory", QDir::currentPath()).toString());
+            QString dateTimeString = QDateTime::currentDateTime().toString("yyyy_MM_dd_hh_mm_ss_zzz");
+            auto format = settings.value("video_format", "mp4").toString();
+            auto fps = settings.value("video_fps", 30).toDouble();
+            auto path = dir.filePath(QString("video_%1.%2").arg(dateTimeString, format));
+            auto output = muJoCoOpenGlWindow->startRecording(path, fps);
+            if (output.isEmpty()) {
+                QMessageBox::warning(this, tr("Record Error"), tr("Could not start recording to \"%1\".")
+                        .arg(QDir::toNativeSeparators(path)));
+            } else {
+                qDebug() << "Recording to" << QDir::toNativeSeparators(output);
+            }
+        });
+        connect(muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::recordingChanged, [this](bool isRecording) {
+            recordVideoAction->setChecked(isRecording);
+        });
+
         saveXMLAction = new QAction("Save XML", this);
         connect(saveXMLAction, &QAction::triggered, [this]() {
             auto dirPath = settings.value("xml_model_directory",
@@ -207,6 +255,7 @@ private:
         connect(settingsAction, &QAction::triggered, [this]() {
             SettingsDialog dialog(settings, this);
             dialog.exec();
+            applySettings();
         });
 
         auto *fileMenu = menuBar()->addMenu("&File");
@@ -214,6 +263,8 @@ private:
         fileMenu->addAction(closeAction);
         fileMenu->addSeparator();
         fileMenu->addAction(screenshotAction);
+        fileMenu->addAction(burstScreenshotAction);
+        fileMenu->addAction(recordVideoAction);
         fileMenu->addSeparator();
         fileMenu->addAction(saveXMLAction);
         fileMenu->addAction(saveMJBAction);
@@ -246,6 +297,37 @@ private:
             muJoCoOpenGlWindow->setShowProfiler(checked);
         });
         optionMenu->addAction(profilerAction);
+
+        // spans of the simulation, render, loader and scrub threads, written to the telemetry directory when stopped
+        auto traceAction = new QAction("Record &Trace", this);
+        traceAction->setCheckable(true);
+        connect(traceAction, &QAction::triggered, [this](bool checked) {
+            if (checked) {
+                auto dir = QDir(settings.value("telemetry_directory", QDir::currentPath()).toString());
+                QString dateTimeString = QDateTime::currentDateTime().toString("yyyy_MM_dd_hh_mm_ss_zzz");
+                tracePath = dir.filePath(QString("trace_%1.json").arg(dateTimeString));
+                muJoCoOpenGlWindow->startTrace();
+                return;
+            }
+            if (!muJoCoOpenGlWindow->stopTrace(tracePath)) {
+                QMessageBox::warning(this, tr("Trace Error"), tr("Could not write the trace to \"%1\".")
+                        .arg(QDir::toNativeSeparators(tracePath)));
+            }
+        });
+        optionMenu->addAction(traceAction);
+
+        // wait and hold times of the simulation mutex per call site; counting starts over after each export
+        auto lockStatsAction = new QAction("Export &Lock Statistics", this);
+        connect(lockStatsAction, &QAction::triggered, [this]() {
+            auto dir = QDir(settings.value("telemetry_directory", QDir::currentPath()).toString());
+            QString dateTimeString = QDateTime::currentDateTime().toString("yyyy_MM_dd_hh_mm_ss_zzz");
+            auto path = dir.filePath(QString("locks_%1.csv").arg(dateTimeString));
+            if (!muJoCoOpenGlWindow->exportLockStats(path, true)) {
+                QMessageBox::warning(this, tr("Export Error"), tr("Could not write the lock statistics to \"%1\".")
+                        .arg(QDir::toNativeSeparators(path)));
+            }
+        });
+        optionMenu->addAction(lockStatsAction);
         optionMenu->addSeparator();
 
 
@@ -259,6 +341,25 @@ private:
         optionMenu->addSeparator();
 
 
+        // viewport layout; double-clicking a view cycles its camera
+        auto *viewportsMenu = optionMenu->addMenu("&Viewports");
+        viewportLayoutGroup = new QActionGroup(this);
+        for (auto [layout, name]: {std::pair{ViewportLayout::SINGLE, "&Single"},
+                                   std::pair{ViewportLayout::SIDE_BY_SIDE, "Side by Side"},
+                                   std::pair{ViewportLayout::GRID, "2 x 2 &Grid"}}) {
+            auto *action = new QAction(name, this);
+            action->setCheckable(true);
+            action->setData(static_cast<int>(layout));
+            viewportLayoutGroup->addAction(action);
+            viewportsMenu->addAction(action);
+        }
+        connect(viewportLayoutGroup, &QActionGroup::triggered, [this](QAction *action) {
+            settings.setValue("viewport_layout", action->data().toInt());
+            applySettings();
+        });
+        optionMenu->addSeparator();
+
+
         auto fullScreenAction = new QAction("&Full Screen", this);
         fullScreenAction->setCheckable(true);
         fullScreenAction->setChecked(false);
@@ -306,6 +407,74 @@ private:
         connect(resetAction, &QAction::triggered, muJoCoOpenGlWindow, &MuJoCoOpenGLWindow::resetSimulation);
 
         resetAction->setShortcut(QKeySequence("Ctrl+R"));
+
+        simulationMenu->addSeparator();
+
+        // Physics threads, same setting as in the settings dialog
+        auto *threadsMenu = simulationMenu->addMenu("Physics &Threads");
+        physicsThreadsGroup = new QActionGroup(this);
+        for (int nworker = 0; nworker <= QThread::idealThreadCount(); nworker = nworker ? nworker * 2 : 2) {
+            auto *action = new QAction(nworker ? QString::number(nworker) : QString("Off"), this);
+            action->setCheckable(true);
+            action->setData(nworker);
+            physicsThreadsGroup->addAction(action);
+            threadsMenu->addAction(action);
+        }
+        connect(physicsThreadsGroup, &QActionGroup::triggered, [this](QAction *action) {
+            settings.setValue("physics_threads", action->data().toInt());
+            applySettings();
+        });
+
+        threadsMenu->addSeparator();
+        islandSolverAction = new QAction("Solve Islands Separately", this);
+        islandSolverAction->setCheckable(true);
+        connect(islandSolverAction, &QAction::triggered, [this](bool checked) {
+            settings.setValue("physics_islands", checked);
+            applySettings();
+        });
+        threadsMenu->addAction(islandSolverAction);
+    }
+
+    // forward settings that configure the simulation rather than file paths
+    void applySettings() {
+        auto historyFileDirectory = settings.value("history_file_directory", QDir::currentPath()).toString();
+        auto historyFileSize = settings.value("history_file_size_mb", 0).toLongLong();
+        muJoCoOpenGlWindow->setHistoryFile(historyFileDirectory, historyFileSize << 20);
+
+        auto screenshotDirectory = settings.value("screenshot_directory", QDir::currentPath()).toString();
+        auto screenshotFormat = settings.value("screenshot_format", "png").toString();
+        muJoCoOpenGlWindow->setScreenshotOptions(screenshotDirectory, screenshotFormat);
+        if (burstScreenshotAction->isChecked()) {
+            muJoCoOpenGlWindow->setScreenshotBurst(settings.value("screenshot_burst_interval", 10).toInt());
+        }
+
+        auto telemetryDirectory = settings.value("telemetry_directory", QDir::currentPath()).toString();
+        auto telemetryFormat = settings.value("telemetry_format", "off").toString();
+        auto telemetryFileSize = settings.value("telemetry_file_size_mb", 256).toLongLong();
+        auto telemetryFiles = settings.value("telemetry_files", 8).toInt();
+        muJoCoOpenGlWindow->setTelemetry(telemetryDirectory, telemetryFormat, telemetryFileSize << 20, telemetryFiles);
+
+        auto modelCacheDirectory = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+                .filePath("models");
+        auto modelCacheSize = settings.value("model_cache_size_mb", 1024).toLongLong();
+        muJoCoOpenGlWindow->setModelCache(modelCacheDirectory, modelCacheSize << 20);
+
+        auto physicsThreads = settings.value("physics_threads", 0).toInt();
+        auto physicsIslands = settings.value("physics_islands", false).toBool();
+        muJoCoOpenGlWindow->setPhysicsThreads(physicsThreads, physicsIslands);
+        for (auto *action: physicsThreadsGroup->actions()) {
+            action->setChecked(action->data().toInt() == physicsThreads);
+        }
+        islandSolverAction->setChecked(physicsIslands);
+
+        auto viewportLayout = settings.value("viewport_layout", static_cast<int>(ViewportLayout::SINGLE)).toInt();
+        if (viewportLayout != ViewportLayout::SIDE_BY_SIDE && viewportLayout != ViewportLayout::GRID) {
+            viewportLayout = ViewportLayout::SINGLE;
+        }
+        muJoCoOpenGlWindow->setViewportLayout(static_cast<ViewportLayout::Layout>(viewportLayout));
+        for (auto *action: viewportLayoutGroup->actions()) {
+            action->setChecked(action->data().toInt() == viewportLayout);
+        }
     }
 
     void initializeRenderingEffectsButtonsChecked() {
@@ -344,7 +513,7 @@ private:
 
     void updateControlPanelWhenModelIsNotNull() {
         controlPanel->renderingSection->show();
-        controlPanel->simulationSection->resetWhenModelIsNotNull(muJoCoOpenGlWindow->getSimulationHistoryBufferSize(),
+        controlPanel->simulationSection->resetWhenModelIsNotNull(muJoCoOpenGlWindow->getSimulationHistoryLength(),
                                                                  [this](int value) {
                                                                      pauseAction->setChecked(true);
                                                                      muJoCoOpenGlWindow->changeHistoryBufferScrubIndex(
@@ -358,6 +527,10 @@ private:
         closeAction->setEnabled(false);
 
         screenshotAction->setEnabled(false);
+        burstScreenshotAction->setEnabled(false);
+        recordVideoAction->setEnabled(false);
+        burstScreenshotAction->setChecked(false);
+        muJoCoOpenGlWindow->setScreenshotBurst(0);
         saveXMLAction->setEnabled(false);
         saveMJBAction->setEnabled(false);
 
@@ -376,6 +549,8 @@ private:
         closeAction->setEnabled(true);
 
         screenshotAction->setEnabled(true);
+        burstScreenshotAction->setEnabled(true);
+        recordVideoAction->setEnabled(true);
         saveXMLAction->setEnabled(true);
         saveMJBAction->setEnabled(true);
 
@@ -397,6 +572,8 @@ private:
 
     QAction *closeAction;
     QAction *screenshotAction;
+    QAction *burstScreenshotAction;
+    QAction *recordVideoAction;
     QAction *saveXMLAction;
     QAction *saveMJBAction;
 
@@ -406,9 +583,15 @@ private:
     QAction *profilerAction;
     QAction *pauseUpdateAction;
     QAction *busyWaitAction;
+    QActionGroup *viewportLayoutGroup;
+
+    QProgressDialog *loadProgressDialog;
+    QString tracePath; // where the running trace is written when it stops
 
     QAction *pauseAction;
     QAction *resetAction;
+    QActionGroup *physicsThreadsGroup;
+    QAction *islandSolverAction;
 
 
     QSettings settings;
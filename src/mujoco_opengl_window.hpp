@@ -4,7 +4,6 @@
 #include <QOpenGLWindow>
 #include <mujoco/mujoco.h>
 #include <QMessageBox>
-#include <QTimer>
 #include <QElapsedTimer>
 #include <QMutex>
 #include <QWaitCondition>
@@ -13,7 +12,12 @@
 
 #include <QWheelEvent>
 #include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLContext>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTimer>
 
 #include <QtLogging>
 
@@ -25,6 +29,14 @@
 
 #include "core/simulation_worker.hpp"
 #include "core/profiler.hpp"
+#include "core/scene_capacity.hpp"
+#include "core/viewport_layout.hpp"
+#include "core/model_loader.hpp"
+#include "core/render_asset_cache.hpp"
+#include "core/trace_recorder.hpp"
+#include "pixel_readback.hpp"
+#include "image_writer.hpp"
+#include "video_recorder.hpp"
 
 inline mjtMouse get_mjtMouse(Qt::MouseButton dragButton, Qt::KeyboardModifiers modifiers) {
     if (dragButton == Qt::LeftButton && (modifiers & Qt::ShiftModifier)) {
@@ -43,46 +55,87 @@ inline mjtMouse get_mjtMouse(Qt::MouseButton dragButton, Qt::KeyboardModifiers m
 }
 
 
-static constexpr int MAX_GEOM = 2000;
-
 class MuJoCoOpenGLWindow : public QOpenGLWindow {
 Q_OBJECT
 
 public:
     /**
-     * For now the rendering fps is fixed.
+     * Frames are only drawn when something changed (see `scheduleFrame`), at most once per vsync.
      */
-    explicit MuJoCoOpenGLWindow(mjrContext con,
-                                int fps = 60)
+    explicit MuJoCoOpenGLWindow(mjrContext con)
             : QOpenGLWindow(),
               simulationWorker(nullptr, nullptr),
-              con(con) {
+              con(con),
+              modelLoader([this](ModelLoader::Result &&result) {
+                  QMetaObject::invokeMethod(this, [this, result]() mutable {
+                      finishLoading(std::move(result));
+                  }, Qt::QueuedConnection);
+              }, [this](uint64_t ticket, const std::string &path, ModelLoader::Stage stage) {
+                  if (stage == ModelLoader::COMPILING) {
+                      auto file = QFileInfo(QString::fromStdString(path)).fileName();
+                      QString text = QString("Compiling %1...").arg(file);
+                      QMetaObject::invokeMethod(this, [this, ticket, text]() {
+                          if (ticket == loadTicket) {
+                              emit loadModelProgress(text);
+                          }
+                      }, Qt::QueuedConnection);
+                  }
+              }) {
 
-        mjv_defaultCamera(&cam);
         mjv_defaultOption(&opt);
         mjv_defaultPerturb(&pert);
         mjv_defaultScene(&scn);
-        mjv_makeScene(nullptr, &scn, MAX_GEOM); // Allocate scene
+        mjv_makeScene(nullptr, &scn, MIN_SCENE_GEOM); // Allocate scene
         std::copy(scn.flags, scn.flags + mjtRndFlag::mjNRNDFLAG, renderingEffects);
 
         profiler.initialize();
+        fpsTimer.start();
 
-        // Initialize the render timer
-        renderTimer.setInterval(1000 / fps);
-        connect(&renderTimer, &QTimer::timeout, [this]() {
-            sync();
-            update();
+        imageWriter.setCallback([this](const QString &path, bool ok) {
+            emit screenshotSaved(path, ok);
+        });
+
+        // redraw when the simulation publishes a new state; this runs on the simulation thread, so post at
+        // most one event until the next frame is painted
+        simulationWorker.setSnapshotCallback([this]() {
+            if (!snapshotPending.exchange(true)) {
+                QMetaObject::invokeMethod(this, [this]() { scheduleFrame(); }, Qt::QueuedConnection);
+            }
         });
-        renderTimer.start();
 
+        // the swap interval paces the frames: the next one is only requested once this one is on screen
+        connect(this, &QOpenGLWindow::frameSwapped, [this]() {
+            recordSwap();
+            framePending = false;
+            if (dirty) {
+                framePending = true;
+                update();
+            }
+        });
+
+        // nothing is painted while the window is hidden or idle, but the simulation keeps filling the rings
+        drainTimer.setInterval(50);
+        connect(&drainTimer, &QTimer::timeout, [this]() { drainRings(); });
+        drainTimer.start();
     }
 
     ~MuJoCoOpenGLWindow() override {
+        modelLoader.cancel();
+        videoRecorder.stop();
+
         simulationWorker.terminateSimulation();
         if (simulationThread.joinable()) {
             simulationThread.join();
         }
 
+        // save the screenshots still in flight, without signalling a half-destroyed window
+        makeCurrent();
+        screenshotReadback.flush(screenshotConsumer());
+        screenshotReadback.release();
+        doneCurrent();
+        imageWriter.wait();
+        imageWriter.setCallback(nullptr);
+
         mjv_freeScene(&scn);
         mjr_freeContext(&con);
     }
@@ -95,8 +148,9 @@ public:
         return opt.flags[flag];
     }
 
-    int getSimulationHistoryBufferSize() const {
-        return simulationWorker.getHistoryBufferSize();
+    // number of history frames that can be scrubbed now; grows as the simulation runs, see `historyLengthChanged`
+    int getSimulationHistoryLength() const {
+        return simulationWorker.getHistoryBufferAvailable();
     }
 
 public slots:
@@ -104,69 +158,42 @@ public slots:
     void pauseSimulation(bool pause) {
         simulationWorker.setSimulationPaused(pause);
         emit isPauseChanged(pause);
+        scheduleFrame();
     }
 
     void resetSimulation() {
         simulationWorker.resetSimulation();
-        update(); // Trigger a redraw to reflect the reset state
+        scheduleFrame(); // Trigger a redraw to reflect the reset state
     }
 
+    /**
+     * Compile the model on a background thread; the current model keeps running until the new one is swapped in.
+     * Emits `loadModelProgress`, then `loadModelSuccess`, `loadModelFailure` or, if cancelled, `loadModelCancelled`.
+     */
     void loadModel(const QString &filename) {
-        mjModel *newModel = nullptr;
-
         isLoading = true;
+        loadingFile = QFileInfo(filename).fileName();
+        loadTicket = modelLoader.load(filename.toStdString());
+        emit loadModelStarted(filename);
+        scheduleFrame();
+    }
 
-        // std::this_thread::sleep_for(std::chrono::milliseconds{1000});
-
-        // Attempt to load the new model first without altering the current state
-        char error[1000] = "Could not load binary model";
-        QFileInfo fileInfo = QFileInfo(filename);
-        if (fileInfo.suffix().compare("xml", Qt::CaseInsensitive) == 0) {
-            newModel = mj_loadXML(filename.toStdString().c_str(), nullptr, error, sizeof(error));
-        } else if (fileInfo.suffix().compare("mjb", Qt::CaseInsensitive) == 0) {
-            newModel = mj_loadModel(filename.toStdString().c_str(), nullptr);
-        } else {
-            qWarning()
-                    << "loadModel method supports only '.xml' and '.mjb' file formats. The provided file path does not match these formats.";
-
-            std::strcpy(error,
-                        "loadModel method supports only '.xml' and '.mjb' file formats. The provided file path does not match these formats.");
-        }
-
-        if (!newModel) {
-            load_error = error;
-            qCritical() << "Load model error:" << error;
-            isLoading = false;
-            emit loadModelFailure(simulationWorker.isModelDataNull());
-            return; // Return without changing the current model and data
-        }
-        load_error.clear();
-
-        mjv_makeScene(newModel, &scn, MAX_GEOM); // Allocate scene
-        std::copy(renderingEffects, renderingEffects + mjtRndFlag::mjNRNDFLAG, scn.flags);
-
-        simulationWorker.replace(newModel);
-        if (!simulationThread.joinable()) {
-            simulationThread = std::thread([&]() { simulationWorker.startSimulationLoop(); });
+    // the compile itself cannot be interrupted, its result is discarded
+    void cancelLoading() {
+        if (loadTicket == 0) {
+            return;
         }
-
-        mjv_defaultCamera(&cam);
-
-
+        modelLoader.cancel();
+        loadTicket = 0;
         isLoading = false;
-
-        initializeGL();
-
-
-        emit loadModelSuccess();
-
-        // Trigger a redraw to reflect the new model
-        update();
-
-        return;
+        emit loadModelCancelled(); // nothing changed, the current model (if any) keeps running
+        scheduleFrame();
     }
 
     void closeModel() {
+        cancelLoading();
+        stopRecording();
+
         simulationWorker.terminateSimulation();
         if (simulationThread.joinable()) {
             simulationThread.join();
@@ -176,6 +203,18 @@ public slots:
     }
 
     void saveXML(const QString &filename) {
+        if (modelFromCache) {
+            // never parsed: the loader parses the unchanged source again, off the GUI thread, and saves right after
+            modelLoader.reparseForSave(modelSourcePath, modelCacheKey,
+                                       [this, file = filename.toStdString()](const std::string &error) {
+                                           if (error.empty()) {
+                                               simulationWorker.save_xml(file);
+                                           } else {
+                                               qWarning() << "Save XML error:" << QString::fromStdString(error);
+                                           }
+                                       });
+            return;
+        }
         simulationWorker.save_xml(filename.toStdString());
     }
 
@@ -194,10 +233,12 @@ public slots:
     void setRenderingFlag(mjtRndFlag flag, bool value) {
         renderingEffects[flag] = value;
         scn.flags[flag] = value;
+        scheduleFrame();
     }
 
     void setModelElement(mjtVisFlag flag, bool value) {
         opt.flags[flag] = value;
+        scheduleFrame();
     }
 
     /**
@@ -215,6 +256,7 @@ public slots:
         slowdown_index = std::clamp(slowdown_index + increment, 0, lengthOfPercentRealTime - 1);
 
         simulationWorker.setSlowdown(100 / percentRealTime[slowdown_index]);
+        scheduleFrame();
     }
 
     void changeHistoryBufferScrubIndex(int index) {
@@ -228,6 +270,7 @@ public slots:
 
     void setShowProfiler(bool value) {
         showProfiler = value;
+        scheduleFrame();
     }
 
     void setPauseUpdate(bool value) {
@@ -238,21 +281,174 @@ public slots:
         simulationWorker.setBusyWait(value);
     }
 
+    // 0 threads: single-threaded
+    void setPhysicsThreads(int nworker, bool islands) {
+        simulationWorker.setPhysicsThreads(nworker, islands);
+    }
+
+    /**
+     * Save the next rendered frame. The pixels are read back asynchronously and encoded on a background thread;
+     * `screenshotSaved` reports the result.
+     */
+    void takeScreenshot() {
+        pendingScreenshots++;
+        scheduleFrame();
+    }
+
+    // save every `interval`-th rendered frame (0: off)
+    void setScreenshotBurst(int interval) {
+        screenshotBurstInterval = std::max(0, interval);
+
+        uint64_t dropped = skippedScreenshots + imageWriter.takeDropped();
+        skippedScreenshots = 0;
+        if (dropped > 0) {
+            qWarning() << "Screenshots: the image writer fell behind," << dropped << "frames were not saved.";
+        }
+    }
+
+    bool isScreenshotBurstActive() const {
+        return screenshotBurstInterval > 0;
+    }
+
+    void setScreenshotOptions(const QString &directory, const QString &format) {
+        screenshotDirectory = directory;
+        screenshotFormat = format;
+    }
+
+    /**
+     * Record the current view at `fps` frames per second of simulation time, at the window's pixel size.
+     * @return the file being written, empty on failure
+     */
+    QString startRecording(const QString &path, double fps) {
+        videoRecorder.setView(viewports.mainCamera(), opt);
+        QString output = videoRecorder.start(simulationWorker, path, fps,
+                                             static_cast<int>(width() * devicePixelRatio()),
+                                             static_cast<int>(height() * devicePixelRatio()));
+        emit recordingChanged(videoRecorder.isRecording());
+        return output;
+    }
+
+    void stopRecording() {
+        if (!videoRecorder.isRecording()) {
+            return;
+        }
+        videoRecorder.stop();
+        emit recordingChanged(false);
+    }
+
+    bool isRecording() const {
+        return videoRecorder.isRecording();
+    }
+
+    void setViewportLayout(ViewportLayout::Layout layout) {
+        viewports.setLayout(layout);
+        scheduleFrame();
+    }
+
+    ViewportLayout::Layout getViewportLayout() const {
+        return viewports.getLayout();
+    }
+
+    // compiled-model cache for XML files, 0 bytes: off
+    void setModelCache(const QString &directory, qint64 maxBytes) {
+        modelLoader.setCache(directory.toStdString(), static_cast<uintmax_t>(std::max<qint64>(0, maxBytes)));
+    }
+
+    /**
+     * Stream every simulation step to rotating files in `directory`; `format` is "csv" or "binary", anything else
+     * stops. Only a changed configuration starts a new session.
+     */
+    void setTelemetry(const QString &directory, const QString &format, qint64 maxFileBytes, int maxFiles) {
+        QString config = QString("%1|%2|%3|%4").arg(directory, format).arg(maxFileBytes).arg(maxFiles);
+        if (config == telemetryConfig) {
+            return;
+        }
+        telemetryConfig = config;
+
+        bool enabled = format == "csv" || format == "binary";
+        auto sinkFormat = format == "binary" ? TelemetrySink::BINARY : TelemetrySink::CSV;
+        if (!simulationWorker.setTelemetry(enabled ? directory.toStdString() : std::string(), sinkFormat,
+                                           static_cast<uintmax_t>(std::max<qint64>(0, maxFileBytes)), maxFiles)) {
+            qWarning() << "Could not write telemetry to" << directory;
+        }
+    }
+
+    // record spans of all threads until `stopTrace`, see `TraceRecorder`
+    void startTrace() {
+        TraceRecorder::instance().start();
+    }
+
+    // write the spans recorded since `startTrace` as Chrome trace-event JSON
+    bool stopTrace(const QString &path) {
+        std::string error;
+        if (!TraceRecorder::instance().stop(path.toStdString(), error)) {
+            qWarning() << "Trace:" << QString::fromStdString(error);
+            return false;
+        }
+        if (TraceRecorder::instance().droppedSpans() > 0) {
+            qWarning() << "Trace: dropped" << TraceRecorder::instance().droppedSpans() << "spans";
+        }
+        qDebug() << "Trace written to" << path;
+        return true;
+    }
+
+    // per-site wait and hold times of the simulation mutex since the start (or the last export), as CSV
+    bool exportLockStats(const QString &path, bool reset) {
+        LockStats &stats = simulationWorker.getLockStats();
+        if (!stats.exportCsv(path.toStdString())) {
+            qWarning() << "Could not write lock statistics to" << path;
+            return false;
+        }
+        if (reset) {
+            stats.reset();
+        }
+        qDebug() << "Lock statistics written to" << path;
+        return true;
+    }
+
+    // takes effect when the next model is loaded
+    void setHistoryFile(const QString &directory, qint64 maxBytes) {
+        simulationWorker.setHistoryFile(directory.toStdString(), static_cast<size_t>(std::max<qint64>(0, maxBytes)));
+    }
+
 signals:
 
+    void loadModelStarted(const QString &filename);
+
+    void loadModelProgress(const QString &text);
+
     void loadModelSuccess();
 
     void loadModelFailure(bool isNull);
 
+    void loadModelCancelled();
+
 
     void isPauseChanged(bool isPaused);
 
+    void historyLengthChanged(int frames);
+
+    // emitted from an encoder thread
+    void screenshotSaved(const QString &path, bool ok);
+
+    void recordingChanged(bool isRecording);
+
 protected:
     void initializeGL() override {
+        TraceRecorder::instance().nameThread("gui");
         simulationWorker.makeContext(&con);
+        renderAssets.clear();
     }
 
     void paintGL() override {
+        TraceSpan span("paintGL", "render");
+        QElapsedTimer stageTimer;
+        stageTimer.start();
+
+        dirty = false;
+        snapshotPending = false;
+        double lockWait = guiLockWaitMsec();
+        sync();
 
         auto f = QOpenGLContext::currentContext()->functions();
         Q_ASSERT(f->hasOpenGLFeature(QOpenGLFunctions::OpenGLFeature::FixedFunctionPipeline));
@@ -262,11 +458,16 @@ protected:
                             static_cast<int>(height() * devicePixelRatio())};
 
 
-        if (simulationWorker.isModelDataNull()) {
+        // only the mutex waits are lock time, the rest of `sync` is profiler bookkeeping
+        bool isModelDataNull = simulationWorker.isModelDataNull();
+        double syncTime = lapMsec(stageTimer);
+        renderTimes.lock = std::clamp(guiLockWaitMsec() - lockWait, 0.0, syncTime);
+        renderTimes.profiler = syncTime - renderTimes.lock;
+
+        if (isModelDataNull) {
             mjr_rectangle(viewport, 0.2f, 0.3f, 0.4f, 1);
 
-            // Currently, `loadModel` executes in the main loop, rendering the loading flag unused.
-            // Moving `loadModel` to a separate thread triggers an error: "ERROR: Could not allocate offscreen framebuffer".
+            // models compile on the loader thread; only the rendering context is created here, see `finishLoading`
             if (isLoading) {
                 mjr_overlay(mjFONT_BIG, mjGRID_TOP, viewport, "LOADING...", nullptr,
                             &con);
@@ -285,16 +486,51 @@ protected:
         }
 
 
-        simulationWorker.updateScene(&opt, &pert, &cam, &scn);
-        mjr_render(viewport, &scn, &con);
+        // the geometry is updated once, from the main camera; the other views only update the camera
+        viewports.resize(viewport.width, viewport.height);
+        simulationWorker.updateScene(&opt, &pert, &viewports.mainCamera(), &scn);
+        if (scn.ngeom >= scn.maxgeom && scn.maxgeom < MAX_SCENE_GEOM) {
+            growScene();
+            simulationWorker.updateScene(&opt, &pert, &viewports.mainCamera(), &scn);
+        }
+        renderTimes.scene = lapMsec(stageTimer);
+        renderTimes.render = 0;
+        renderTimes.overlay = 0;
+        for (int i = 0; i < viewports.count(); i++) {
+            auto &view = viewports.view(i);
+            if (i > 0) {
+                simulationWorker.updateCamera(&view.cam, &scn);
+                renderTimes.scene += lapMsec(stageTimer);
+            }
+            mjr_render(view.rect, &scn, &con);
+            std::copy(scn.camera, scn.camera + 2, view.glcam);
+            renderTimes.render += lapMsec(stageTimer);
+            if (viewports.count() > 1) {
+                mjr_overlay(mjFONT_NORMAL, mjGRID_BOTTOMLEFT, view.rect, view.label.c_str(), nullptr, &con);
+                renderTimes.overlay += lapMsec(stageTimer);
+            }
+        }
+
+        if (isLoading) {
+            QString s = QString("Loading %1...").arg(loadingFile);
+            mjr_overlay(mjFONT_NORMAL, mjGRID_BOTTOMRIGHT, viewport, s.toStdString().c_str(), nullptr, &con);
+        }
+
+        if (videoRecorder.isRecording()) {
+            videoRecorder.setView(viewports.mainCamera(), opt);
+            mjr_overlay(mjFONT_NORMAL, mjGRID_TOPRIGHT, viewport, "REC", nullptr, &con);
+        }
 
         // PAUSE
         if (simulationWorker.isPaused()) {
             QString s;
-            if (simulationWorker.getHistoryBufferScrubIndex() == 0) {
+            // the index the slider asked for may lie before the oldest stored frame, which is what is shown
+            int scrubIndex = std::max(simulationWorker.getHistoryBufferScrubIndex(),
+                                      1 - simulationWorker.getHistoryBufferAvailable());
+            if (scrubIndex == 0) {
                 s = "PAUSE";
             } else {
-                s = QString("PAUSE (%1)").arg(simulationWorker.getHistoryBufferScrubIndex());
+                s = QString("PAUSE (%1)").arg(scrubIndex);
             }
 
             mjr_overlay(mjFONT_BIG, mjGRID_TOP, viewport, s.toStdString().c_str(), nullptr,
@@ -305,7 +541,9 @@ protected:
         // real time (%)
         {
             float desiredRealtime = percentRealTime[slowdown_index];
-            float actualRealtime = 100 / simulationWorker.getMeasuredSlowDown();
+            double realtimeFactor = simulationWorker.getRealtimeStatistics().realtimeFactor;
+            float actualRealtime = realtimeFactor > 0 ? static_cast<float>(100 * realtimeFactor)
+                                                      : static_cast<float>(100 / simulationWorker.getMeasuredSlowDown());
 
             // if running, check for misalignment of more than 10%
             float realtime_offset = mju_abs(actualRealtime - desiredRealtime);
@@ -334,19 +572,27 @@ protected:
         if (showProfiler) {
             profiler.show(&con, viewport);
         }
+        renderTimes.overlay += lapMsec(stageTimer);
+
+        captureScreenshots(viewport);
 
+        // screenshots in flight are only delivered by later frames
+        if (screenshotReadback.isPending() || pendingScreenshots > 0) {
+            scheduleFrame();
+        }
+        swapTimer.start();
     }
 
 
     void resizeGL(int w, int h) override {
-        // Update viewport here if necessary
+        scheduleFrame();
     }
 
 
     void wheelEvent(QWheelEvent *event) override {
         constexpr mjtNum zoom_increment = 0.02;
         auto delta = event->angleDelta().y() / 120;
-        simulationWorker.moveCamera(mjtMouse::mjMOUSE_ZOOM, 0, delta * zoom_increment, &scn, &cam);
+        moveViewCamera(viewAt(event->position().toPoint()), mjtMouse::mjMOUSE_ZOOM, 0, delta * zoom_increment);
     }
 
 
@@ -356,6 +602,7 @@ protected:
             event->button() == Qt::MiddleButton) {
             dragging = true;
             dragStartPosition = event->pos();
+            dragView = viewAt(event->pos());
             dragButton = event->button();
             modifiers = event->modifiers();
         }
@@ -365,6 +612,15 @@ protected:
         dragging = false;
     }
 
+    // double click: next camera for the view under the cursor
+    void mouseDoubleClickEvent(QMouseEvent *event) override {
+        int index = viewAt(event->pos());
+        simulationWorker.accessModelAndData([this, index](mjModel *m, mjData *) {
+            viewports.cycleCamera(m, index);
+        });
+        scheduleFrame();
+    }
+
     void mouseMoveEvent(QMouseEvent *event) override {
         if (!dragging) return;
 
@@ -377,27 +633,251 @@ protected:
 
         auto action = get_mjtMouse(dragButton, modifiers);
 
-        auto relX = 1.0 * delta.x() / width();
-        auto relY = 1.0 * delta.y() / height();
+        // relative to the size of the dragged view
+        const mjrRect &rect = viewports.view(dragView).rect;
+        auto relX = 1.0 * delta.x() * devicePixelRatio() / std::max(1, rect.width);
+        auto relY = 1.0 * delta.y() * devicePixelRatio() / std::max(1, rect.height);
 
-        simulationWorker.moveCamera(action, relX, relY, &scn, &cam);
+        moveViewCamera(dragView, action, relX, relY);
 
         dragStartPosition = event->pos();
     }
 
 private:
 
+    /**
+     * Mark the frame out of date. The redraw happens right away if no frame is in flight, otherwise when the
+     * one in flight has been swapped, so there is at most one paint per vsync and none while nothing changes.
+     */
+    void scheduleFrame() {
+        dirty = true;
+        if (!framePending) {
+            framePending = true;
+            update();
+        }
+    }
+
+    /**
+     * Swap in a model compiled by `modelLoader`. The OpenGL work has to happen here, on the GUI thread with the
+     * window's context current.
+     */
+    void finishLoading(ModelLoader::Result &&result) {
+        TraceSpan span("finishLoading", "load");
+        // superseded by a newer request, or cancelled
+        if (result.ticket != loadTicket || result.cancelled) {
+            mj_deleteModel(result.model);
+            return;
+        }
+        loadTicket = 0;
+
+        if (!result.model) {
+            load_error = QString::fromStdString(result.error);
+            qCritical() << "Load model error:" << load_error;
+            isLoading = false;
+            emit loadModelFailure(simulationWorker.isModelDataNull());
+            scheduleFrame();
+            return; // Return without changing the current model and data
+        }
+        load_error.clear();
+        qDebug() << (result.fromCache ? "Loaded cached" : "Compiled") << QString::fromStdString(result.path)
+                 << "in" << result.seconds << "s";
+        modelFromCache = result.fromCache;
+        modelSourcePath = result.path;
+        modelCacheKey = result.cacheKey;
+        emit loadModelProgress("Creating the rendering context...");
+
+        // the recording belongs to the old model
+        stopRecording();
+
+        // the scene holds per-model buffers, so it is rebuilt, but keeps its capacity if that still fits
+        mjModel *newModel = result.model;
+        mjv_makeScene(newModel, &scn, sceneCapacityForModel(newModel, &opt, scn.maxgeom)); // Allocate scene
+        std::copy(renderingEffects, renderingEffects + mjtRndFlag::mjNRNDFLAG, scn.flags);
+
+        simulationWorker.replace(newModel);
+        simulationWorker.getStepLatency().collect();
+        simulationWorker.getStepLatency().clearWindow(); // old model's steps
+        lastHistoryLength = 0;
+        if (!simulationThread.joinable()) {
+            simulationThread = std::thread([&]() { simulationWorker.startSimulationLoop(); });
+        }
+
+        simulationWorker.accessModelAndData([this](mjModel *m, mjData *) {
+            viewports.assignCameras(m);
+        });
+
+        isLoading = false;
+
+        makeCurrent();
+        uploadModelAssets();
+        doneCurrent();
+
+        emit loadModelSuccess();
+
+        // Trigger a redraw to reflect the new model
+        scheduleFrame();
+    }
+
+    // bring the rendering context up to date with the current model, re-uploading only the assets that changed
+    void uploadModelAssets() {
+        TraceSpan span("uploadModelAssets", "load");
+        QElapsedTimer timer;
+        timer.start();
+        RenderAssetCache::Stats stats;
+        simulationWorker.accessModelAndData([this, &stats](mjModel *m, mjData *) {
+            stats = renderAssets.update(m, &con);
+        });
+        if (stats.rebuilt) {
+            qDebug() << "Rendering context created in" << timer.elapsed() << "ms";
+        } else {
+            qDebug() << "Rendering context reused, re-uploaded" << stats.uploaded << "of" << stats.total
+                     << "assets in" << timer.elapsed() << "ms";
+        }
+    }
+
+    // index of the view under a point in window coordinates
+    int viewAt(const QPoint &pos) const {
+        return viewports.viewAt(static_cast<int>(pos.x() * devicePixelRatio()),
+                                static_cast<int>((height() - pos.y()) * devicePixelRatio()));
+    }
+
+    void moveViewCamera(int index, mjtMouse action, mjtNum relX, mjtNum relY) {
+        auto &view = viewports.view(index);
+        if (view.cam.type == mjCAMERA_FIXED) {
+            return;
+        }
+        // mjv_moveCamera works in the frame of the scene's camera, which is the one this view was last drawn with
+        std::copy(view.glcam, view.glcam + 2, scn.camera);
+        simulationWorker.moveCamera(action, relX, relY, &scn, &view.cam);
+        scheduleFrame();
+    }
+
+    // the scene filled up (more contacts than expected, or more decorations enabled): double its capacity
+    void growScene() {
+        int maxgeom = grownSceneCapacity(scn);
+        qDebug() << "Scene full at" << scn.maxgeom << "geoms, growing to" << maxgeom;
+        simulationWorker.makeScene(&scn, maxgeom);
+        std::copy(renderingEffects, renderingEffects + mjtRndFlag::mjNRNDFLAG, scn.flags);
+    }
+
+    // read back the finished frame if a screenshot is due; `paintGL` calls this last
+    void captureScreenshots(const mjrRect &viewport) {
+        if (!screenshotReadback.isInitialized()) {
+            screenshotReadback.initialize();
+        }
+
+        bool burst = screenshotBurstInterval > 0 && renderedFrames % screenshotBurstInterval == 0;
+        if (burst && imageWriter.isFull()) {
+            // the encoders fell behind: do not even read the frame back
+            burst = false;
+            skippedScreenshots++;
+        }
+        if (pendingScreenshots > 0 || burst) {
+            if (pendingScreenshots > 0) {
+                pendingScreenshots--;
+            }
+            auto f = QOpenGLContext::currentContext()->extraFunctions();
+            f->glBindFramebuffer(GL_READ_FRAMEBUFFER, defaultFramebufferObject());
+            if (defaultFramebufferObject() == 0) {
+                f->glReadBuffer(GL_BACK);
+            }
+            screenshotReadback.request(viewport.left, viewport.bottom, viewport.width, viewport.height,
+                                       renderedFrames, screenshotConsumer());
+        }
+        screenshotReadback.endFrame(screenshotConsumer());
+        renderedFrames++;
+    }
+
+    PixelReadback::Consumer screenshotConsumer() {
+        return [this](PixelReadback::Frame &&frame) {
+            if (frame.rgb.empty()) {
+                qWarning() << "Screenshot" << frame.tag << "could not be read back.";
+                return;
+            }
+            QString dateTimeString = QDateTime::currentDateTime().toString("yyyy_MM_dd_hh_mm_ss_zzz");
+            auto path = QDir(screenshotDirectory).filePath(
+                    QString("screenshot_%1_%2").arg(dateTimeString).arg(frame.tag));
+            imageWriter.write(std::move(frame), path, screenshotFormat);
+        };
+    }
+
+
+    // msec since the last lap
+    static double lapMsec(QElapsedTimer &timer) {
+        double msec = static_cast<double>(timer.nsecsElapsed()) / 1e6;
+        timer.restart();
+        return msec;
+    }
+
+    // called when a frame reaches the screen; completes its `renderTimes`
+    void recordSwap() {
+        if (!swapTimer.isValid()) {
+            return;
+        }
+        renderTimes.swap = static_cast<double>(swapTimer.nsecsElapsed()) / 1e6;
+        swapTimer.invalidate();
+        renderTimesReady = true;
+
+        swappedFrames++;
+        if (fpsTimer.elapsed() >= 500) {
+            renderTimes.fps = swappedFrames * 1000.0 / static_cast<double>(fpsTimer.elapsed());
+            swappedFrames = 0;
+            fpsTimer.restart();
+        }
+    }
+
+    // total time this thread has waited for the simulation mutex, msec; see `LockStats`
+    double guiLockWaitMsec() {
+        const LockStats &lockStats = simulationWorker.getLockStats();
+        double wait = 0;
+        for (auto site: {LockStats::ACCESS_MODEL_AND_DATA, LockStats::CLEAR_DATA_TIMERS,
+                         LockStats::IS_MODEL_DATA_NULL}) {
+            wait += lockStats.summary(site).waitTotal;
+        }
+        return wait * 1e3;
+    }
+
+    // move recorded steps and trace spans out of their rings, on every frame and on `drainTimer`
+    void drainRings() {
+        if (TraceRecorder::isEnabled()) {
+            TraceRecorder::instance().collect();
+        }
+        if (simulationWorker.getStepLatency().collect() > 0) {
+            newLatencySteps = true;
+        }
+    }
 
     void sync() {
+        // the render side is timed whether or not the simulation runs
+        if (showProfiler && renderTimesReady) {
+            profiler.updateRender(renderTimes);
+            renderTimesReady = false;
+        }
+
+        drainRings();
+
         bool update_profiler = showProfiler && (pauseUpdate || (!simulationWorker.isPaused()));
 
         if (update_profiler) {
             simulationWorker.accessModelAndData([this](mjModel *m, mjData *d) {
                 profiler.update(m, d);
             });
+            profiler.updateThreads(simulationWorker.getPhysicsSpeedup(), simulationWorker.getPhysicsThreads());
+            if (newLatencySteps) {
+                profiler.updateLatency(simulationWorker.getStepLatency());
+                newLatencySteps = false;
+            }
+            profiler.updateLocks(simulationWorker.getLockStats().summaries());
+            profiler.updateRealtime(simulationWorker.getRealtimeStatistics(), 1 / simulationWorker.getSlowDown());
         }
 
         simulationWorker.clearDataTimers();
+
+        int historyLength = simulationWorker.getHistoryBufferAvailable();
+        if (historyLength != lastHistoryLength) {
+            lastHistoryLength = historyLength;
+            emit historyLengthChanged(historyLength);
+        }
     }
 
     SimulationWorker simulationWorker;
@@ -405,18 +885,50 @@ private:
     bool showProfiler = false;
     bool pauseUpdate = true; // update the profiler and the sensor even if the simulation is paused
 
-    mjvCamera cam; // MuJoCo camera
+    ViewportLayout viewports; // cameras, the first one is the interactive free camera
     mjvOption opt; // Visualization options
     mjvPerturb pert;
     mjvScene scn; // Scene for rendering
     mjrContext con; // Rendering context
-
-    QTimer renderTimer;
+    RenderAssetCache renderAssets; // what `con` holds, see `uploadModelAssets`
+
+    // event-driven rendering
+    bool dirty = false;          // something changed since the last paint
+    bool framePending = false;   // update() was called and its frame has not been swapped yet
+    std::atomic_bool snapshotPending = false;
+
+    // render-path timing, shown by the profiler
+    Profiler::RenderTimes renderTimes; // the last frame, complete once it has been swapped
+    bool renderTimesReady = false;
+    int lastHistoryLength = 0; // last `historyLengthChanged`
+    QTimer drainTimer;                 // see `drainRings`
+    bool newLatencySteps = false;      // steps collected since the latency figures were updated
+    QElapsedTimer swapTimer;           // end of paintGL to frameSwapped
+    QElapsedTimer fpsTimer;
+    int swappedFrames = 0;
+
+    VideoRecorder videoRecorder;
+
+    // screenshots
+    PixelReadback screenshotReadback;
+    ImageWriter imageWriter;
+    int pendingScreenshots = 0;
+    int screenshotBurstInterval = 0;
+    uint64_t skippedScreenshots = 0; // burst frames not read back because the image writer was full
+    long long renderedFrames = 0;
+    QString screenshotDirectory = QDir::currentPath();
+    QString screenshotFormat = "png";
 
     std::thread simulationThread;
 
 
     std::atomic_bool isLoading = false;
+    QString loadingFile;
+    uint64_t loadTicket = 0; // result of `modelLoader` to swap in, 0 if none
+    bool modelFromCache = false;
+    std::string modelSourcePath;   // file the current model was loaded from
+    std::string modelCacheKey;     // its inputs when loaded from the cache, see `ModelLoader::reparseForSave`
+    QString telemetryConfig;
     QString load_error;
 
     mjtByte renderingEffects[mjtRndFlag::mjNRNDFLAG];
@@ -424,6 +936,7 @@ private:
 
     bool dragging = false;
     QPoint dragStartPosition;
+    int dragView = 0;
     Qt::MouseButton dragButton;
     Qt::KeyboardModifiers modifiers;
 
@@ -435,6 +948,9 @@ private:
     };
 
     int slowdown_index = 0;
+
+    // last, so it is joined before the members its callbacks use are destroyed
+    ModelLoader modelLoader;
 };
 
 #endif //QMUJOCOSIM_MUJOCO_OPENGL_WINDOW_HPP
@@ -0,0 +1,170 @@
+#ifndef QMUJOCOSIM_OFFSCREEN_RENDERER_HPP
+#define QMUJOCOSIM_OFFSCREEN_RENDERER_HPP
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QSurfaceFormat>
+#include <QtLogging>
+
+#include <mujoco/mujoco.h>
+
+#include <memory>
+
+#include "core/scene_capacity.hpp"
+#include "pixel_readback.hpp"
+
+
+/**
+ * Renders a model into MuJoCo's offscreen framebuffer of a `QOffscreenSurface` context, without a window.
+ *
+ * Frames are read back asynchronously (see `PixelReadback`), so the consumer receives each frame
+ * `PixelReadback::kLatency` `render` calls later; `finish` delivers the rest. Run with QT_QPA_PLATFORM=offscreen
+ * (or any platform with surfaceless/pbuffer OpenGL, e.g. Mesa llvmpipe) on machines without a display.
+ *
+ * The renderer may live on another thread than the GUI: call `createSurface` on the GUI thread first, then
+ * `initialize`, `render` and `release` on the rendering thread.
+ */
+class OffscreenRenderer {
+public:
+    // maxGeom 0: sized from the model (see `estimateSceneCapacity`), growing if it fills up
+    OffscreenRenderer(int width, int height, int maxGeom = 0)
+            : width(width), height(height), maxGeom(maxGeom) {
+        mjv_defaultCamera(&cam);
+        mjv_defaultOption(&opt);
+        mjv_defaultScene(&scn);
+        mjr_defaultContext(&con);
+    }
+
+    ~OffscreenRenderer() {
+        release();
+        surface.reset();
+    }
+
+    OffscreenRenderer(const OffscreenRenderer &) = delete;
+
+    OffscreenRenderer &operator=(const OffscreenRenderer &) = delete;
+
+    // Qt requires this on the GUI thread; `initialize` calls it if it has not been called
+    void createSurface() {
+        if (surface) {
+            return;
+        }
+        surface = std::make_unique<QOffscreenSurface>();
+        surface->setFormat(QSurfaceFormat::defaultFormat());
+        surface->create();
+    }
+
+    /**
+     * Create the OpenGL context, current on the calling thread, and the MuJoCo rendering context for `m`.
+     */
+    bool initialize(const mjModel *m) {
+        release();
+        createSurface();
+
+        context = std::make_unique<QOpenGLContext>();
+        context->setFormat(QSurfaceFormat::defaultFormat());
+        if (!context->create() || !context->makeCurrent(surface.get())) {
+            qCritical() << "Offscreen renderer: could not create an OpenGL context.";
+            context.reset();
+            return false;
+        }
+
+        mjv_makeScene(m, &scn, maxGeom > 0 ? maxGeom : estimateSceneCapacity(m, &opt));
+        mjr_makeContext(m, &con, mjFONTSCALE_100);
+        mjr_setBuffer(mjFB_OFFSCREEN, &con);
+        if (con.offWidth != width || con.offHeight != height) {
+            mjr_resizeOffscreen(width, height, &con);
+        }
+        if (con.currentBuffer != mjFB_OFFSCREEN) {
+            qCritical() << "Offscreen renderer: offscreen framebuffer not supported.";
+            release();
+            return false;
+        }
+
+        readback.initialize();
+        return true;
+    }
+
+    void release() {
+        if (!context) {
+            return;
+        }
+        context->makeCurrent(surface.get());
+        readback.release();
+        mjr_freeContext(&con);
+        mjv_freeScene(&scn);
+        context->doneCurrent();
+        context.reset();
+    }
+
+    mjvCamera &camera() {
+        return cam;
+    }
+
+    mjvOption &option() {
+        return opt;
+    }
+
+    mjvScene &scene() {
+        return scn;
+    }
+
+    /**
+     * Render `d` and start reading it back; frames that finished transferring are handed to `consumer`.
+     * @param tag passed to the consumer with the frame, e.g. a frame number
+     */
+    void render(const mjModel *m, mjData *d, long long tag, const PixelReadback::Consumer &consumer) {
+        context->makeCurrent(surface.get());
+
+        mjrRect viewport = {0, 0, width, height};
+        mjv_updateScene(m, d, &opt, nullptr, &cam, mjCAT_ALL, &scn);
+        if (maxGeom == 0 && scn.ngeom >= scn.maxgeom && scn.maxgeom < MAX_SCENE_GEOM) {
+            mjv_makeScene(m, &scn, grownSceneCapacity(scn));
+            mjv_updateScene(m, d, &opt, nullptr, &cam, mjCAT_ALL, &scn);
+        }
+        mjr_setBuffer(mjFB_OFFSCREEN, &con);
+        mjr_render(viewport, &scn, &con);
+
+        bindResolvedFramebuffer();
+        readback.request(0, 0, width, height, tag, consumer);
+        readback.endFrame(consumer);
+    }
+
+    // deliver the frames still in flight
+    void finish(const PixelReadback::Consumer &consumer) {
+        context->makeCurrent(surface.get());
+        readback.flush(consumer);
+    }
+
+private:
+    // with multisampling the render target cannot be read directly; resolve it into the single-sample FBO
+    void bindResolvedFramebuffer() {
+        auto *gl = context->extraFunctions();
+        if (con.offSamples > 0) {
+            gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, con.offFBO);
+            gl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, con.offFBO_r);
+            gl->glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, con.offFBO_r);
+        } else {
+            gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, con.offFBO);
+        }
+        gl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+
+    int width;
+    int height;
+    int maxGeom;
+
+    std::unique_ptr<QOffscreenSurface> surface;
+    std::unique_ptr<QOpenGLContext> context;
+
+    mjvCamera cam;
+    mjvOption opt;
+    mjvScene scn;
+    mjrContext con;
+
+    PixelReadback readback;
+};
+
+#endif //QMUJOCOSIM_OFFSCREEN_RENDERER_HPP
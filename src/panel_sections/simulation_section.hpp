@@ -4,6 +4,7 @@
 
 #include <functional>
 #include <mutex>
+#include <algorithm>
 
 #include <QGridLayout>
 #include <QVBoxLayout>
@@ -47,13 +48,15 @@ public:
     }
 
     void
-    resetWhenModelIsNotNull(int simulationHistoryBufferSize, std::function<void(int)> onHistorySliderValueChanged,
+    resetWhenModelIsNotNull(int simulationHistoryLength, std::function<void(int)> onHistorySliderValueChanged,
                             std::function<void()> onValueIsZeroAndKeyRightPressed) {
         labelSlider->setEnabled(true);
         labelSlider->setValueNoSignal(0);
-        labelSlider->setRange(0, simulationHistoryBufferSize - 1);
+        setHistoryLength(simulationHistoryLength);
 
 
+        // replaces the handler of the previous model
+        disconnect(labelSlider, &LabelSlider::valueChanged, nullptr, nullptr);
         connect(labelSlider, &LabelSlider::valueChanged, onHistorySliderValueChanged);
 
         {
@@ -84,6 +87,11 @@ public slots:
         labelSlider->setValueNoSignal(value);
     };
 
+    // the slider reaches back to the oldest of `frames` stored history frames
+    void setHistoryLength(int frames) {
+        labelSlider->setRange(0, std::max(0, frames - 1));
+    }
+
     // Step backward.
     void onKeyLeftPressed() {
         if (!labelSlider->isEnabled()) return;
@@ -0,0 +1,193 @@
+#ifndef QMUJOCOSIM_PIXEL_READBACK_HPP
+#define QMUJOCOSIM_PIXEL_READBACK_HPP
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+
+/**
+ * Asynchronous RGB readback through a ring of pixel buffer objects.
+ *
+ * `request` starts a glReadPixels of the current read framebuffer into the next PBO and returns without waiting
+ * for the transfer. `endFrame`, called once per rendered frame, maps PBOs only `kLatency` frames after their
+ * request, by which time the GPU has long finished the transfer, so reading pixels never stalls the render loop.
+ * Rows are delivered top-down. Every request is delivered exactly once; one whose buffer could not be mapped is
+ * delivered with empty `rgb`, so consumers can keep track of what they requested.
+ *
+ * All calls must be made with the same OpenGL context current.
+ */
+class PixelReadback {
+public:
+    struct Frame {
+        std::vector<uint8_t> rgb;   // width * height * 3 bytes, top row first; empty if the read failed
+        int width = 0;
+        int height = 0;
+        long long tag = 0;          // passed through from `request`
+    };
+
+    using Consumer = std::function<void(Frame &&frame)>;
+
+    static constexpr int kSlots = 3;
+    static constexpr int kLatency = kSlots - 1;   // frames between request and delivery
+
+    PixelReadback() = default;
+
+    ~PixelReadback() {
+        release();
+    }
+
+    PixelReadback(const PixelReadback &) = delete;
+
+    PixelReadback &operator=(const PixelReadback &) = delete;
+
+    void initialize() {
+        release();
+        gl = QOpenGLContext::currentContext()->extraFunctions();
+        gl->glGenBuffers(kSlots, buffers.data());
+        for (auto &slot: slots) {
+            slot = Slot{};
+        }
+        next = 0;
+        frame = 0;
+    }
+
+    void release() {
+        if (gl == nullptr) {
+            return;
+        }
+        gl->glDeleteBuffers(kSlots, buffers.data());
+        gl = nullptr;
+    }
+
+    bool isInitialized() const {
+        return gl != nullptr;
+    }
+
+    bool isPending() const {
+        for (const auto &slot: slots) {
+            if (slot.pending) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Start reading `width` x `height` pixels at (x, y) of the bound read framebuffer. If every slot is in use,
+     * the oldest read is handed to `consumer` first, which may wait for the GPU.
+     */
+    void request(int x, int y, int width, int height, long long tag, const Consumer &consumer) {
+        Slot &slot = slots[next];
+        if (slot.pending) {
+            deliver(next, consumer);
+        }
+
+        size_t bytes = static_cast<size_t>(width) * height * 3;
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[next]);
+        if (bytes != slot.capacity) {
+            gl->glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_READ);
+            slot.capacity = bytes;
+        }
+        gl->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        gl->glReadPixels(x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.pending = true;
+        slot.width = width;
+        slot.height = height;
+        slot.tag = tag;
+        slot.frame = frame;
+        slot.sequence = ++sequence;
+        next = (next + 1) % kSlots;
+    }
+
+    /**
+     * Mark the end of a rendered frame and hand the reads requested `kLatency` frames ago to `consumer`.
+     */
+    void endFrame(const Consumer &consumer) {
+        frame++;
+        while (true) {
+            int oldest = oldestPending();
+            if (oldest < 0 || frame - slots[oldest].frame < kLatency) {
+                return;
+            }
+            deliver(oldest, consumer);
+        }
+    }
+
+    /**
+     * Hand every outstanding read to `consumer`, oldest first. This waits for the GPU.
+     */
+    void flush(const Consumer &consumer) {
+        for (int oldest = oldestPending(); oldest >= 0; oldest = oldestPending()) {
+            deliver(oldest, consumer);
+        }
+    }
+
+private:
+    struct Slot {
+        bool pending = false;
+        size_t capacity = 0;
+        int width = 0;
+        int height = 0;
+        long long tag = 0;
+        uint64_t frame = 0;      // `endFrame` count at the request
+        uint64_t sequence = 0;   // request order
+    };
+
+    int oldestPending() const {
+        int oldest = -1;
+        for (int s = 0; s < kSlots; s++) {
+            if (slots[s].pending && (oldest < 0 || slots[s].sequence < slots[oldest].sequence)) {
+                oldest = s;
+            }
+        }
+        return oldest;
+    }
+
+    void deliver(int index, const Consumer &consumer) {
+        Slot &slot = slots[index];
+        slot.pending = false;
+
+        Frame result;
+        result.width = slot.width;
+        result.height = slot.height;
+        result.tag = slot.tag;
+        size_t row = static_cast<size_t>(slot.width) * 3;
+        result.rgb.resize(row * slot.height);
+
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[index]);
+        auto *pixels = static_cast<const uint8_t *>(
+                gl->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(result.rgb.size()),
+                                     GL_MAP_READ_BIT));
+        if (pixels) {
+            // OpenGL rows run bottom-up
+            for (int r = 0; r < slot.height; r++) {
+                std::memcpy(result.rgb.data() + r * row, pixels + (slot.height - 1 - r) * row, row);
+            }
+            gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            result.rgb.clear();
+        }
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (consumer) {
+            consumer(std::move(result));
+        }
+    }
+
+    QOpenGLExtraFunctions *gl = nullptr;
+    std::array<GLuint, kSlots> buffers = {};
+    std::array<Slot, kSlots> slots = {};
+    int next = 0;
+    uint64_t frame = 0;
+    uint64_t sequence = 0;
+};
+
+#endif //QMUJOCOSIM_PIXEL_READBACK_HPP
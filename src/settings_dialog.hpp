@@ -10,6 +10,11 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QDir>
+#include <QSpinBox>
+#include <QLabel>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QThread>
 #include "custom_widgets/directory_selector.hpp"  // Assuming DirectorySelector is in a separate header
 
 class SettingsDialog : public QDialog {
@@ -22,6 +27,19 @@ private:
     DirectorySelector *printModelDirectorySelector;
     DirectorySelector *printDataDirectorySelector;
     DirectorySelector *screenshotDirectorySelector;
+    QComboBox *screenshotFormatComboBox;
+    QSpinBox *screenshotBurstSpinBox;
+    QComboBox *videoFormatComboBox;
+    QSpinBox *videoFpsSpinBox;
+    DirectorySelector *historyFileDirectorySelector;
+    QSpinBox *historyFileSizeSpinBox;
+    QSpinBox *modelCacheSizeSpinBox;
+    DirectorySelector *telemetryDirectorySelector;
+    QComboBox *telemetryFormatComboBox;
+    QSpinBox *telemetryFileSizeSpinBox;
+    QSpinBox *telemetryFilesSpinBox;
+    QSpinBox *physicsThreadsSpinBox;
+    QCheckBox *islandSolverCheckBox;
     QSettings &settings;
 
     const QString defaultButtonStyle = "QPushButton { background-color: white; }";
@@ -47,6 +65,120 @@ public:
         initializeDirectorySelector(printModelDirectorySelector, "Print Model Directory:", "print_model_directory");
         initializeDirectorySelector(printDataDirectorySelector, "Print Data Directory:", "print_data_directory");
         initializeDirectorySelector(screenshotDirectorySelector, "Screenshot Directory:", "screenshot_directory");
+        initializeDirectorySelector(historyFileDirectorySelector, "History File Directory:", "history_file_directory");
+        initializeDirectorySelector(telemetryDirectorySelector, "Telemetry Directory:", "telemetry_directory");
+
+        // screenshots are encoded in the background, so slower formats do not hold up rendering
+        auto screenshotLayout = new QHBoxLayout();
+        screenshotFormatComboBox = new QComboBox(this);
+        screenshotFormatComboBox->addItems({"png", "exr", "jpg", "bmp"});
+        screenshotFormatComboBox->setCurrentText(settings.value("screenshot_format", "png").toString());
+        connect(screenshotFormatComboBox, &QComboBox::currentTextChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        screenshotBurstSpinBox = new QSpinBox(this);
+        screenshotBurstSpinBox->setRange(1, 10000);
+        screenshotBurstSpinBox->setPrefix("every ");
+        screenshotBurstSpinBox->setSuffix(" frames");
+        screenshotBurstSpinBox->setValue(settings.value("screenshot_burst_interval", 10).toInt());
+        connect(screenshotBurstSpinBox, &QSpinBox::valueChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        screenshotLayout->addWidget(new QLabel("Screenshot Format:", this));
+        screenshotLayout->addWidget(screenshotFormatComboBox);
+        screenshotLayout->addWidget(new QLabel("Burst:", this));
+        screenshotLayout->addWidget(screenshotBurstSpinBox);
+
+        // videos go to the screenshot directory; anything but y4m is encoded by ffmpeg, if installed
+        auto videoLayout = new QHBoxLayout();
+        videoFormatComboBox = new QComboBox(this);
+        videoFormatComboBox->addItems({"mp4", "mkv", "y4m"});
+        videoFormatComboBox->setCurrentText(settings.value("video_format", "mp4").toString());
+        connect(videoFormatComboBox, &QComboBox::currentTextChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        videoFpsSpinBox = new QSpinBox(this);
+        videoFpsSpinBox->setRange(1, 1000);
+        videoFpsSpinBox->setSuffix(" fps (simulation time)");
+        videoFpsSpinBox->setValue(settings.value("video_fps", 30).toInt());
+        connect(videoFpsSpinBox, &QSpinBox::valueChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        videoLayout->addWidget(new QLabel("Video Format:", this));
+        videoLayout->addWidget(videoFormatComboBox);
+        videoLayout->addWidget(videoFpsSpinBox);
+
+        // 0 keeps the history in memory
+        auto historyFileSizeLayout = new QHBoxLayout();
+        historyFileSizeSpinBox = new QSpinBox(this);
+        historyFileSizeSpinBox->setRange(0, 1 << 20);
+        historyFileSizeSpinBox->setSuffix(" MB");
+        historyFileSizeSpinBox->setSpecialValueText("Off (in memory)");
+        historyFileSizeSpinBox->setValue(settings.value("history_file_size_mb", 0).toInt());
+        connect(historyFileSizeSpinBox, &QSpinBox::valueChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        historyFileSizeLayout->addWidget(new QLabel("History File Size (next model load):", this));
+        historyFileSizeLayout->addWidget(historyFileSizeSpinBox);
+
+        // compiled models, so reopening an XML file skips the compiler; 0 always compiles
+        auto modelCacheLayout = new QHBoxLayout();
+        modelCacheSizeSpinBox = new QSpinBox(this);
+        modelCacheSizeSpinBox->setRange(0, 1 << 20);
+        modelCacheSizeSpinBox->setSuffix(" MB");
+        modelCacheSizeSpinBox->setSpecialValueText("Off");
+        modelCacheSizeSpinBox->setValue(settings.value("model_cache_size_mb", 1024).toInt());
+        connect(modelCacheSizeSpinBox, &QSpinBox::valueChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        modelCacheLayout->addWidget(new QLabel("Compiled Model Cache:", this));
+        modelCacheLayout->addWidget(modelCacheSizeSpinBox);
+
+        // every simulation step, written in the background to files that rotate at the given size
+        auto telemetryLayout = new QHBoxLayout();
+        telemetryFormatComboBox = new QComboBox(this);
+        telemetryFormatComboBox->addItems({"off", "csv", "binary"});
+        telemetryFormatComboBox->setCurrentText(settings.value("telemetry_format", "off").toString());
+        connect(telemetryFormatComboBox, &QComboBox::currentTextChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        telemetryFileSizeSpinBox = new QSpinBox(this);
+        telemetryFileSizeSpinBox->setRange(1, 1 << 20);
+        telemetryFileSizeSpinBox->setSuffix(" MB per file");
+        telemetryFileSizeSpinBox->setValue(settings.value("telemetry_file_size_mb", 256).toInt());
+        connect(telemetryFileSizeSpinBox, &QSpinBox::valueChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        telemetryFilesSpinBox = new QSpinBox(this);
+        telemetryFilesSpinBox->setRange(1, 10000);
+        telemetryFilesSpinBox->setPrefix("keep ");
+        telemetryFilesSpinBox->setSuffix(" files");
+        telemetryFilesSpinBox->setValue(settings.value("telemetry_files", 8).toInt());
+        connect(telemetryFilesSpinBox, &QSpinBox::valueChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        telemetryLayout->addWidget(new QLabel("Step Telemetry:", this));
+        telemetryLayout->addWidget(telemetryFormatComboBox);
+        telemetryLayout->addWidget(telemetryFileSizeSpinBox);
+        telemetryLayout->addWidget(telemetryFilesSpinBox);
+
+        // 0 steps on the simulation thread only
+        auto physicsThreadsLayout = new QHBoxLayout();
+        physicsThreadsSpinBox = new QSpinBox(this);
+        physicsThreadsSpinBox->setRange(0, QThread::idealThreadCount());
+        physicsThreadsSpinBox->setSpecialValueText("Off (single-threaded)");
+        physicsThreadsSpinBox->setValue(settings.value("physics_threads", 0).toInt());
+        connect(physicsThreadsSpinBox, &QSpinBox::valueChanged, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        islandSolverCheckBox = new QCheckBox("Solve islands separately", this);
+        islandSolverCheckBox->setChecked(settings.value("physics_islands", false).toBool());
+        connect(islandSolverCheckBox, &QCheckBox::toggled, [this]() {
+            saveButton->setStyleSheet(modifiedButtonStyle);
+        });
+        physicsThreadsLayout->addWidget(new QLabel("Physics Threads:", this));
+        physicsThreadsLayout->addWidget(physicsThreadsSpinBox);
+        physicsThreadsLayout->addWidget(islandSolverCheckBox);
 
         // Add selectors to frame layout
         frameLayout->addWidget(xmlModelDirectorySelector);
@@ -54,6 +186,14 @@ public:
         frameLayout->addWidget(printModelDirectorySelector);
         frameLayout->addWidget(printDataDirectorySelector);
         frameLayout->addWidget(screenshotDirectorySelector);
+        frameLayout->addLayout(screenshotLayout);
+        frameLayout->addLayout(videoLayout);
+        frameLayout->addWidget(historyFileDirectorySelector);
+        frameLayout->addLayout(historyFileSizeLayout);
+        frameLayout->addLayout(modelCacheLayout);
+        frameLayout->addWidget(telemetryDirectorySelector);
+        frameLayout->addLayout(telemetryLayout);
+        frameLayout->addLayout(physicsThreadsLayout);
         mainLayout->addWidget(frame);
 
         // Buttons for saving and closing
@@ -86,6 +226,19 @@ private:
         allSaved &= saveDirectorySetting(printModelDirectorySelector, "print_model_directory");
         allSaved &= saveDirectorySetting(printDataDirectorySelector, "print_data_directory");
         allSaved &= saveDirectorySetting(screenshotDirectorySelector, "screenshot_directory");
+        allSaved &= saveDirectorySetting(historyFileDirectorySelector, "history_file_directory");
+        allSaved &= saveDirectorySetting(telemetryDirectorySelector, "telemetry_directory");
+        settings.setValue("screenshot_format", screenshotFormatComboBox->currentText());
+        settings.setValue("screenshot_burst_interval", screenshotBurstSpinBox->value());
+        settings.setValue("video_format", videoFormatComboBox->currentText());
+        settings.setValue("video_fps", videoFpsSpinBox->value());
+        settings.setValue("history_file_size_mb", historyFileSizeSpinBox->value());
+        settings.setValue("model_cache_size_mb", modelCacheSizeSpinBox->value());
+        settings.setValue("telemetry_format", telemetryFormatComboBox->currentText());
+        settings.setValue("telemetry_file_size_mb", telemetryFileSizeSpinBox->value());
+        settings.setValue("telemetry_files", telemetryFilesSpinBox->value());
+        settings.setValue("physics_threads", physicsThreadsSpinBox->value());
+        settings.setValue("physics_islands", islandSolverCheckBox->isChecked());
         return allSaved;
     }
 
@@ -0,0 +1,337 @@
+#ifndef QMUJOCOSIM_VIDEO_RECORDER_HPP
+#define QMUJOCOSIM_VIDEO_RECORDER_HPP
+
+#include <QString>
+#include <QStringList>
+#include <QStandardPaths>
+#include <QProcess>
+#include <QtLogging>
+
+#include <mujoco/mujoco.h>
+
+#include <cstdio>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "core/simulation_worker.hpp"
+#include "core/frame_capture.hpp"
+#include "offscreen_renderer.hpp"
+
+
+/**
+ * Records a video with one frame per 1/fps seconds of simulation time, whatever the slowdown.
+ *
+ * The simulation thread only copies `mjData` at frame boundaries (see `FrameCapture`). Rendering, readback and
+ * encoding run on the recorder's own thread with its own offscreen OpenGL context. Output is a Y4M stream, or,
+ * for any other extension and if `ffmpeg` is on the PATH, whatever ffmpeg makes of raw RGB frames piped to it.
+ * ffmpeg is started by the recorder thread with an argument list, no shell is involved.
+ */
+class VideoRecorder {
+public:
+    VideoRecorder() {
+        mjv_defaultCamera(&viewCamera);
+        mjv_defaultOption(&viewOption);
+    }
+
+    ~VideoRecorder() {
+        stop();
+    }
+
+    VideoRecorder(const VideoRecorder &) = delete;
+
+    VideoRecorder &operator=(const VideoRecorder &) = delete;
+
+    /**
+     * Start recording the model of `worker`. Must be called on the GUI thread.
+     * @return the path actually written (the extension changes to .y4m without ffmpeg), empty on failure; if
+     * ffmpeg then fails to start, this is logged and nothing is written
+     */
+    QString start(SimulationWorker &worker, const QString &path, double fps, int width, int height) {
+        stop();
+
+        // 4:2:0 chroma needs even dimensions
+        this->width = std::max(2, width & ~1);
+        this->height = std::max(2, height & ~1);
+        this->fps = fps;
+
+        mjModel *model = nullptr;
+        worker.accessModelAndData([&](mjModel *m, mjData *) {
+            model = mj_copyModel(nullptr, m);
+            capture.start(m, 1 / fps);
+        });
+        if (model == nullptr) {
+            return {};
+        }
+
+        QString output = path;
+        piped = false;
+        if (!path.endsWith(".y4m", Qt::CaseInsensitive)) {
+            QString ffmpeg = QStandardPaths::findExecutable("ffmpeg");
+            if (ffmpeg.isEmpty()) {
+                qWarning() << "ffmpeg not found, recording Y4M instead.";
+                output = path.left(path.lastIndexOf('.')) + ".y4m";
+            } else {
+                encoderProgram = ffmpeg;
+                encoderArguments = QStringList{"-loglevel", "error", "-y", "-f", "rawvideo", "-pix_fmt", "rgb24",
+                                               "-s", QString("%1x%2").arg(this->width).arg(this->height),
+                                               "-r", QString::number(fps), "-i", "-", "-pix_fmt", "yuv420p", path};
+                piped = true;
+            }
+        }
+
+        if (!piped) {
+            file = std::fopen(output.toStdString().c_str(), "wb");
+            if (file == nullptr) {
+                qWarning() << "Could not open" << output << "for recording.";
+                capture.stop();
+                mj_deleteModel(model);
+                return {};
+            }
+        }
+
+        renderer = std::make_unique<OffscreenRenderer>(this->width, this->height);
+        renderer->createSurface();
+        stopRequested = false;
+        recorder = std::thread([this, model]() { run(model); });
+
+        worker.setFrameCapture(&capture);
+        this->worker = &worker;
+        return output;
+    }
+
+    /**
+     * Finish the frames captured so far and close the file. Must be called on the GUI thread, before the
+     * worker's model is replaced.
+     */
+    void stop() {
+        if (!recorder.joinable()) {
+            return;
+        }
+        worker->setFrameCapture(nullptr);
+        stopRequested = true;
+        recorder.join();
+        capture.stop();
+        renderer.reset();
+
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+        piped = false;
+        worker = nullptr;
+
+        if (capture.dropped() > 0) {
+            qWarning() << "Video: the recorder fell behind," << capture.dropped() << "frames were repeated.";
+        }
+    }
+
+    bool isRecording() const {
+        return recorder.joinable();
+    }
+
+    // the view to record, normally the window's camera and options
+    void setView(const mjvCamera &cam, const mjvOption &opt) {
+        std::lock_guard<std::mutex> lockGuard(viewMtx);
+        viewCamera = cam;
+        viewOption = opt;
+        viewChanged = true;
+    }
+
+    long long framesWritten() const {
+        return written;
+    }
+
+private:
+    void run(mjModel *model) {
+        bool ready = renderer->initialize(model);
+        if (ready && piped && !startEncoder()) {
+            renderer->release();
+            ready = false;
+        }
+        if (!ready) {
+            // keep draining, so the simulation thread never runs out of buffers
+            while (!stopRequested) {
+                FrameCapture::Frame frame;
+                while (capture.pop(frame)) {
+                    capture.recycle(frame.data);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            mj_deleteModel(model);
+            return;
+        }
+
+        written = 0;
+        repeats.clear();
+        lostRepeats = 0;
+        auto consumer = [this](PixelReadback::Frame &&frame) { encode(frame); };
+
+        while (true) {
+            FrameCapture::Frame frame;
+            if (!capture.pop(frame)) {
+                if (stopRequested) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lockGuard(viewMtx);
+                if (viewChanged) {
+                    renderer->camera() = viewCamera;
+                    renderer->option() = viewOption;
+                    viewChanged = false;
+                }
+            }
+
+            repeats.push_back(frame.repeat);
+            renderer->render(model, frame.data, frame.index, consumer);
+            capture.recycle(frame.data);
+        }
+
+        renderer->finish(consumer);
+        renderer->release();
+        mj_deleteModel(model);
+        finishEncoder();
+        if (lostRepeats > 0) {
+            qWarning() << "Video: the last" << lostRepeats << "frames could not be read back.";
+        }
+    }
+
+    // ffmpeg reads the raw frames from its stdin; the process belongs to the recorder thread
+    bool startEncoder() {
+        encoder = std::make_unique<QProcess>();
+        encoder->setStandardOutputFile(QProcess::nullDevice());
+        encoder->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        encoder->start(encoderProgram, encoderArguments);
+        if (!encoder->waitForStarted()) {
+            qWarning() << "Video: could not start" << encoderProgram << "-" << encoder->errorString();
+            encoder.reset();
+            return false;
+        }
+        return true;
+    }
+
+    void finishEncoder() {
+        if (!encoder) {
+            return;
+        }
+        encoder->closeWriteChannel();
+        encoder->waitForFinished(-1);
+        if (encoder->exitStatus() != QProcess::NormalExit || encoder->exitCode() != 0) {
+            qWarning() << "Video: ffmpeg failed with exit code" << encoder->exitCode();
+        }
+        encoder.reset();
+    }
+
+    void writeBytes(const void *data, size_t size) {
+        if (encoder) {
+            encoder->write(static_cast<const char *>(data), static_cast<qint64>(size));
+            // QProcess buffers whatever it is given; keep at most one frame in flight
+            while (encoder->bytesToWrite() > 0 && encoder->waitForBytesWritten(-1)) {}
+        } else {
+            std::fwrite(data, 1, size, file);
+        }
+    }
+
+    void encode(const PixelReadback::Frame &frame) {
+        int repeat = repeats.front();
+        repeats.pop_front();
+
+        // a frame that could not be read back is replaced by the next one, which keeps the video's timing
+        if (frame.rgb.empty()) {
+            lostRepeats += repeat;
+            return;
+        }
+        repeat += lostRepeats;
+        lostRepeats = 0;
+
+        const std::vector<uint8_t> *bytes = &frame.rgb;
+        if (!piped) {
+            if (written == 0) {
+                std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n", width, height,
+                             static_cast<int>(std::lround(fps * 1000)));
+            }
+            toYuv420(frame);
+            bytes = &yuv;
+        }
+        for (int i = 0; i < repeat; i++) {
+            if (!piped) {
+                std::fputs("FRAME\n", file);
+            }
+            writeBytes(bytes->data(), bytes->size());
+            written++;
+        }
+    }
+
+    // BT.601 full range, chroma averaged over 2x2 blocks
+    void toYuv420(const PixelReadback::Frame &frame) {
+        size_t npixel = static_cast<size_t>(width) * height;
+        yuv.resize(npixel + npixel / 2);
+        uint8_t *y = yuv.data();
+        uint8_t *u = y + npixel;
+        uint8_t *v = u + npixel / 4;
+        const uint8_t *rgb = frame.rgb.data();
+
+        for (size_t i = 0; i < npixel; i++) {
+            const uint8_t *p = rgb + 3 * i;
+            y[i] = static_cast<uint8_t>(std::clamp(0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2], 0.0, 255.0));
+        }
+        for (int r = 0; r < height; r += 2) {
+            for (int c = 0; c < width; c += 2) {
+                double sr = 0, sg = 0, sb = 0;
+                for (int dr = 0; dr < 2; dr++) {
+                    for (int dc = 0; dc < 2; dc++) {
+                        const uint8_t *p = rgb + 3 * (static_cast<size_t>(r + dr) * width + c + dc);
+                        sr += p[0];
+                        sg += p[1];
+                        sb += p[2];
+                    }
+                }
+                sr /= 4;
+                sg /= 4;
+                sb /= 4;
+                size_t k = static_cast<size_t>(r / 2) * (width / 2) + c / 2;
+                u[k] = static_cast<uint8_t>(std::clamp(128 - 0.168736 * sr - 0.331264 * sg + 0.5 * sb, 0.0, 255.0));
+                v[k] = static_cast<uint8_t>(std::clamp(128 + 0.5 * sr - 0.418688 * sg - 0.081312 * sb, 0.0, 255.0));
+            }
+        }
+    }
+
+    FrameCapture capture;
+    std::unique_ptr<OffscreenRenderer> renderer;
+    SimulationWorker *worker = nullptr;
+
+    std::thread recorder;
+    std::atomic_bool stopRequested = false;
+
+    std::mutex viewMtx;
+    mjvCamera viewCamera;
+    mjvOption viewOption;
+    bool viewChanged = true;
+
+    // recorder thread
+    std::FILE *file = nullptr;   // Y4M output
+    bool piped = false;          // raw RGB frames to `encoder`
+    QString encoderProgram;
+    QStringList encoderArguments;
+    std::unique_ptr<QProcess> encoder;
+    int width = 0;
+    int height = 0;
+    double fps = 30;
+    std::deque<int> repeats;   // repeat counts of the frames in flight in the readback
+    int lostRepeats = 0;       // repeat counts of frames whose readback failed, added to the next frame
+    std::vector<uint8_t> yuv;
+    std::atomic<long long> written = 0;
+};
+
+#endif //QMUJOCOSIM_VIDEO_RECORDER_HPP
@@ -0,0 +1,275 @@
+/**
+ * Physics throughput benchmark.
+ *
+ * For every model it measures
+ *   mj_step   bare mj_step on its own mjData
+ *   history   HistoryBuffer::addToHistory (the sim thread's share of history recording)
+ *   worker    SimulationWorker::stepForward: lock, mj_step, history, render snapshot
+ * and writes one CSV row per model and stage. With --baseline, rows are compared against a previous result
+ * file and the exit code is 1 if any stage got slower than the tolerance allows.
+ *
+ * Usage: BENCHMARK_SIMULATION [--steps N] [--output results.csv] [--baseline old.csv] [--tolerance 0.2]
+ *                             [model.xml|model.mjb ...]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+
+#include "core/simulation_worker.hpp"
+#include "mujoco/mujoco.h"
+
+#ifndef EXAMPLE_XML_PATH
+#define EXAMPLE_XML_PATH ""
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+struct StageResult {
+    std::string model;
+    std::string stage;
+    int steps = 0;
+    double stepsPerSecond = 0;
+    double mean = 0;   // all latencies in microseconds
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+static constexpr int kWarmupSteps = 100;
+
+static const char *kCsvHeader = "model,stage,steps,steps_per_sec,mean_us,p50_us,p95_us,p99_us,max_us";
+
+static mjModel *loadModel(const std::string &path) {
+    char error[1000] = "Could not load binary model";
+    mjModel *m = nullptr;
+    if (path.ends_with(".mjb")) {
+        m = mj_loadModel(path.c_str(), nullptr);
+    } else {
+        m = mj_loadXML(path.c_str(), nullptr, error, sizeof(error));
+    }
+    if (!m) {
+        std::cerr << "Could not load " << path << ": " << error << std::endl;
+    }
+    return m;
+}
+
+static double percentile(const std::vector<double> &sorted, double p) {
+    auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// time `step` `steps` times after a short warmup
+static StageResult measure(const std::string &model, const std::string &stage, int steps,
+                           const std::function<void()> &step) {
+    for (int i = 0; i < kWarmupSteps; i++) {
+        step();
+    }
+
+    std::vector<double> latencies(steps);
+    auto begin = Clock::now();
+    for (int i = 0; i < steps; i++) {
+        auto start = Clock::now();
+        step();
+        latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+    double total = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    StageResult result;
+    result.model = model;
+    result.stage = stage;
+    result.steps = steps;
+    result.stepsPerSecond = steps / total;
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency: latencies) {
+        sum += latency;
+    }
+    result.mean = sum / steps;
+    result.p50 = percentile(latencies, 0.50);
+    result.p95 = percentile(latencies, 0.95);
+    result.p99 = percentile(latencies, 0.99);
+    result.max = latencies.back();
+    return result;
+}
+
+static std::vector<StageResult> benchmarkModel(const std::string &path, int steps) {
+    std::vector<StageResult> results;
+    std::string name = std::filesystem::path(path).filename().string();
+
+    // bare mj_step
+    {
+        mjModel *m = loadModel(path);
+        if (!m) {
+            return results;
+        }
+        mjData *d = mj_makeData(m);
+        results.push_back(measure(name, "mj_step", steps, [&]() { mj_step(m, d); }));
+        mj_deleteData(d);
+        mj_deleteModel(m);
+    }
+
+    // history recording, as the simulation thread does after each step; the states are simulated up front
+    {
+        mjModel *m = loadModel(path);
+        mjData *d = mj_makeData(m);
+        int stateSize = mj_stateSize(m, mjSTATE_INTEGRATION);
+        std::vector<mjtNum> states(static_cast<size_t>(kWarmupSteps + steps) * stateSize);
+        for (int i = 0; i < kWarmupSteps + steps; i++) {
+            mj_step(m, d);
+            mj_getState(m, d, states.data() + static_cast<size_t>(i) * stateSize, mjSTATE_INTEGRATION);
+        }
+        mj_resetData(m, d);
+        mj_forward(m, d);
+
+        HistoryBuffer historyBuffer;
+        historyBuffer.initialize(m, d);
+        size_t next = 0;
+        results.push_back(measure(name, "history", steps, [&]() {
+            mj_setState(m, d, states.data() + next++ * stateSize, mjSTATE_INTEGRATION);
+            historyBuffer.addToHistory(m, d);
+        }));
+        historyBuffer.flush();
+        mj_deleteData(d);
+        mj_deleteModel(m);
+    }
+
+    // the full simulation thread pipeline; the worker owns the model
+    {
+        mjModel *m = loadModel(path);
+        SimulationWorker simulationWorker(nullptr, nullptr);
+        simulationWorker.replace(m);
+        simulationWorker.setSimulationPaused(true);
+        results.push_back(measure(name, "worker", steps, [&]() { simulationWorker.stepForward(); }));
+    }
+
+    return results;
+}
+
+static void writeCsv(std::ostream &out, const std::vector<StageResult> &results) {
+    out << kCsvHeader << "\n";
+    for (const auto &r: results) {
+        out << r.model << "," << r.stage << "," << r.steps << "," << r.stepsPerSecond << ","
+            << r.mean << "," << r.p50 << "," << r.p95 << "," << r.p99 << "," << r.max << "\n";
+    }
+}
+
+static std::map<std::string, StageResult> readCsv(const std::string &path) {
+    std::map<std::string, StageResult> results;
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);   // header
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        StageResult r;
+        std::string field;
+        std::getline(ss, r.model, ',');
+        std::getline(ss, r.stage, ',');
+        std::vector<double> values;
+        while (std::getline(ss, field, ',')) {
+            values.push_back(std::stod(field));
+        }
+        if (values.size() != 7) {
+            continue;
+        }
+        r.steps = static_cast<int>(values[0]);
+        r.stepsPerSecond = values[1];
+        r.mean = values[2];
+        r.p50 = values[3];
+        r.p95 = values[4];
+        r.p99 = values[5];
+        r.max = values[6];
+        results[r.model + "/" + r.stage] = r;
+    }
+    return results;
+}
+
+// report stages whose throughput or p99 latency got worse than `tolerance` (relative) against the baseline
+static bool compareWithBaseline(const std::vector<StageResult> &results, const std::string &baselinePath,
+                                double tolerance) {
+    auto baseline = readCsv(baselinePath);
+    bool regressed = false;
+    for (const auto &r: results) {
+        auto it = baseline.find(r.model + "/" + r.stage);
+        if (it == baseline.end()) {
+            std::cout << r.model << "/" << r.stage << ": no baseline" << std::endl;
+            continue;
+        }
+        const StageResult &b = it->second;
+        bool slower = r.stepsPerSecond < b.stepsPerSecond * (1 - tolerance);
+        bool laggier = r.p99 > b.p99 * (1 + tolerance);
+        if (slower || laggier) {
+            regressed = true;
+            std::cout << "REGRESSION " << r.model << "/" << r.stage << ": " << b.stepsPerSecond << " -> "
+                      << r.stepsPerSecond << " steps/s, p99 " << b.p99 << " -> " << r.p99 << " us" << std::endl;
+        }
+    }
+    return !regressed;
+}
+
+int main(int argc, char *argv[]) {
+    int steps = 10000;
+    std::string output = "benchmark_results.csv";
+    std::string baseline;
+    double tolerance = 0.2;
+    std::vector<std::string> models;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--steps" && i + 1 < argc) {
+            steps = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::stod(argv[++i]);
+        } else {
+            models.push_back(arg);
+        }
+    }
+    if (models.empty()) {
+        models.emplace_back(EXAMPLE_XML_PATH);
+    }
+
+    std::cout << "MuJoCo version " << mj_versionString() << std::endl;
+
+    std::vector<StageResult> results;
+    for (const auto &model: models) {
+        auto modelResults = benchmarkModel(model, steps);
+        if (modelResults.empty()) {
+            return 2;
+        }
+        results.insert(results.end(), modelResults.begin(), modelResults.end());
+    }
+
+    writeCsv(std::cout, results);
+
+    // what the simulation thread pays on top of mj_step
+    for (size_t i = 0; i + 2 < results.size(); i += 3) {
+        std::cout << results[i].model << ": pipeline overhead " << results[i + 2].mean - results[i].mean
+                  << " us/step" << std::endl;
+    }
+
+    std::ofstream file(output);
+    if (!file) {
+        std::cerr << "Could not write " << output << std::endl;
+        return 2;
+    }
+    writeCsv(file, results);
+    std::cout << "Results written to " << output << std::endl;
+
+    if (!baseline.empty() && !compareWithBaseline(results, baseline, tolerance)) {
+        return 1;
+    }
+    return 0;
+}
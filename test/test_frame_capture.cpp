@@ -0,0 +1,138 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/frame_capture.hpp"
+#include "mujoco/mujoco.h"
+
+#ifndef EXAMPLE_XML_PATH
+#define EXAMPLE_XML_PATH ""
+#endif
+
+// interval and times are exact in binary, so frame boundaries are hit exactly
+constexpr double interval = 0.25;
+
+TEST_CASE("Frame capture repeats frames whose boundaries one step crossed", "[capture]") {
+    char error[1000];
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+    mjData *d = mj_makeData(m);
+
+    FrameCapture capture;
+    capture.start(m, interval, 4);
+    FrameCapture::Frame frame;
+
+    // the first step is captured
+    d->time = 0;
+    capture.capture(m, d);
+    REQUIRE(capture.pop(frame));
+    REQUIRE(frame.index == 0);
+    REQUIRE(frame.repeat == 1);
+    REQUIRE(frame.data->time == 0);
+    capture.recycle(frame.data);
+
+    // within the interval, nothing
+    d->time = 0.125;
+    capture.capture(m, d);
+    REQUIRE_FALSE(capture.pop(frame));
+
+    // on the boundary
+    d->time = 0.25;
+    capture.capture(m, d);
+    REQUIRE(capture.pop(frame));
+    REQUIRE(frame.index == 1);
+    REQUIRE(frame.repeat == 1);
+    capture.recycle(frame.data);
+
+    // a long step crossing the boundaries at 0.5, 0.75 and 1.0
+    d->time = 1.125;
+    capture.capture(m, d);
+    REQUIRE(capture.pop(frame));
+    REQUIRE(frame.index == 2);
+    REQUIRE(frame.repeat == 3);
+    REQUIRE(frame.data->time == 1.125);
+    capture.recycle(frame.data);
+    REQUIRE(capture.dropped() == 0);
+
+    capture.stop();
+    mj_deleteData(d);
+    mj_deleteModel(m);
+}
+
+TEST_CASE("Frame capture folds dropped frames into the next one", "[capture]") {
+    char error[1000];
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+    mjData *d = mj_makeData(m);
+
+    FrameCapture capture;
+    capture.start(m, interval, 2);
+    FrameCapture::Frame first, second, frame;
+
+    // the consumer does not keep up: the pool of two runs dry
+    for (int i = 0; i < 4; i++) {
+        d->time = i * interval;
+        capture.capture(m, d);
+    }
+    REQUIRE(capture.dropped() == 2);
+    REQUIRE(capture.pop(first));
+    REQUIRE(capture.pop(second));
+    REQUIRE_FALSE(capture.pop(frame));
+    REQUIRE(first.index == 0);
+    REQUIRE(second.index == 1);
+    capture.recycle(first.data);
+    capture.recycle(second.data);
+
+    // the next captured frame stands in for the two dropped ones, so the frame count stays right
+    d->time = 4 * interval;
+    capture.capture(m, d);
+    REQUIRE(capture.pop(frame));
+    REQUIRE(frame.index == 2);
+    REQUIRE(frame.repeat == 3);
+    capture.recycle(frame.data);
+    REQUIRE(capture.dropped() == 2);
+
+    capture.stop();
+    mj_deleteData(d);
+    mj_deleteModel(m);
+}
+
+TEST_CASE("Frame capture restarts its boundaries when time goes back", "[capture]") {
+    char error[1000];
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+    mjData *d = mj_makeData(m);
+
+    FrameCapture capture;
+    capture.start(m, interval, 4);
+    FrameCapture::Frame frame;
+
+    for (double time: {0.0, 0.25, 0.625}) {
+        d->time = time;
+        capture.capture(m, d);
+        REQUIRE(capture.pop(frame));
+        capture.recycle(frame.data);
+    }
+    REQUIRE(frame.index == 2);
+
+    // scrubbed back, but not before the last boundary (0.5): the next boundary stays where it was
+    d->time = 0.5;
+    capture.capture(m, d);
+    REQUIRE_FALSE(capture.pop(frame));
+
+    // reset: captured right away, and the video continues with the next index
+    d->time = 0;
+    capture.capture(m, d);
+    REQUIRE(capture.pop(frame));
+    REQUIRE(frame.index == 3);
+    REQUIRE(frame.repeat == 1);
+    REQUIRE(frame.data->time == 0);
+    capture.recycle(frame.data);
+
+    d->time = 0.25;
+    capture.capture(m, d);
+    REQUIRE(capture.pop(frame));
+    REQUIRE(frame.index == 4);
+    capture.recycle(frame.data);
+
+    capture.stop();
+    mj_deleteData(d);
+    mj_deleteModel(m);
+}
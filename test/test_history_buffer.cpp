@@ -0,0 +1,86 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/history_buffer.hpp"
+#include "mujoco/mujoco.h"
+
+#include <cmath>
+#include <random>
+
+#ifndef EXAMPLE_XML_PATH
+#define EXAMPLE_XML_PATH ""
+#endif
+
+TEST_CASE("State codec round trip", "[codec]") {
+    constexpr int n = 1000;
+    std::mt19937 rng(0);
+    std::normal_distribution<double> noise;
+
+    std::vector<mjtNum> reference(n), state(n), reconstructed(n), decoded(n);
+    for (int i = 0; i < n; i++) {
+        reference[i] = noise(rng);
+        // a mix of unchanged, slightly changed and unrelated values
+        state[i] = i % 3 == 0 ? reference[i] : i % 3 == 1 ? reference[i] + 1e-6 * noise(rng) : noise(rng);
+    }
+
+    SECTION("lossless") {
+        std::vector<uint8_t> bytes;
+        StateCodec::encode(state.data(), reference.data(), n, StateCodec::kLosslessMantissaBits, bytes,
+                           reconstructed.data());
+        const uint8_t *end = StateCodec::decode(bytes.data(), reference.data(), n, decoded.data());
+        REQUIRE(end == bytes.data() + bytes.size());
+        REQUIRE(bytes.size() < n * sizeof(mjtNum));
+        for (int i = 0; i < n; i++) {
+            REQUIRE(decoded[i] == state[i]);
+            REQUIRE(reconstructed[i] == state[i]);
+        }
+    }
+
+    SECTION("quantized") {
+        constexpr int bits = 20;
+        std::vector<uint8_t> bytes;
+        StateCodec::encode(state.data(), reference.data(), n, bits, bytes, reconstructed.data());
+        StateCodec::decode(bytes.data(), reference.data(), n, decoded.data());
+        for (int i = 0; i < n; i++) {
+            REQUIRE(decoded[i] == reconstructed[i]);
+            REQUIRE(std::abs(decoded[i] - state[i]) <= std::ldexp(std::abs(state[i]), -bits));
+        }
+    }
+}
+
+TEST_CASE("History buffer scrubbing", "[history]") {
+    char error[1000];
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+    mjData *d = mj_makeData(m);
+    mj_forward(m, d);
+
+    HistoryBuffer historyBuffer;
+    historyBuffer.initialize(m, d);
+
+    int ns = mj_stateSize(m, mjSTATE_INTEGRATION);
+    constexpr int nstep = 3 * HistoryBuffer::kDenseFrames / 2;
+    std::vector<mjtNum> recorded((nstep + 1) * ns);
+    mj_getState(m, d, recorded.data(), mjSTATE_INTEGRATION);
+    for (int t = 1; t <= nstep; t++) {
+        mj_step(m, d);
+        historyBuffer.addToHistory(m, d);
+        mj_getState(m, d, &recorded[t * ns], mjSTATE_INTEGRATION);
+    }
+    REQUIRE(historyBuffer.available() == nstep + 1);
+
+    std::vector<mjtNum> state(ns);
+    // frames older than kDenseFrames are re-simulated from keyframes and must match exactly
+    for (int back: {0, 1, 31, 32, 33, 150, 4500, 5000, 5001, 4999, nstep - 1, nstep, 2 * nstep}) {
+        historyBuffer.setScrubIndex(-back);
+        historyBuffer.loadScrubState(m, d);
+        mj_getState(m, d, state.data(), mjSTATE_INTEGRATION);
+
+        // going back further than the stored history yields the oldest frame
+        int t = std::max(0, nstep - back);
+        for (int i = 0; i < ns; i++) {
+            REQUIRE(state[i] == recorded[t * ns + i]);
+        }
+    }
+
+    mj_deleteData(d);
+    mj_deleteModel(m);
+}
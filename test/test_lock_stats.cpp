@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/lock_stats.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+TEST_CASE("Timed lock accounts wait and hold time to its site", "[basic]") {
+    std::mutex mtx;
+    LockStats stats;
+
+    std::atomic_bool locking = false;
+    std::thread waiter;
+    {
+        TimedLock lock(mtx, stats, LockStats::SIMULATION_LOOP);
+        waiter = std::thread([&]() {
+            locking = true;
+            TimedLock waiting(mtx, stats, LockStats::ACCESS_MODEL_AND_DATA);
+        });
+
+        // release only once the waiter is about to lock, and has had time to block on the mutex
+        while (!locking) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    waiter.join();
+
+    LockStats::Summary loop = stats.summary(LockStats::SIMULATION_LOOP);
+    REQUIRE(loop.count == 1);
+    REQUIRE(loop.contended == 0);
+    REQUIRE(loop.holdMax >= 0.02);
+
+    LockStats::Summary access = stats.summary(LockStats::ACCESS_MODEL_AND_DATA);
+    REQUIRE(access.count == 1);
+    REQUIRE(access.contended == 1);
+    REQUIRE(access.waitMax > 0);
+
+    REQUIRE(stats.summaries().size() == 2);
+    stats.reset();
+    REQUIRE(stats.summaries().empty());
+}
+
+TEST_CASE("Lock statistics export one CSV row per used site", "[export]") {
+    std::mutex mtx;
+    LockStats stats;
+    for (int i = 0; i < 3; i++) {
+        TimedLock lock(mtx, stats, LockStats::CLEAR_DATA_TIMERS);
+    }
+
+    auto path = std::filesystem::temp_directory_path() / "qmujocosim_test_lock_stats.csv";
+    REQUIRE(stats.exportCsv(path.string()));
+    std::ifstream file(path);
+    std::string header, row, extra;
+    std::getline(file, header);
+    std::getline(file, row);
+    REQUIRE(header.rfind("site,count,", 0) == 0);
+    REQUIRE(row.rfind("clearDataTimers,3,0,", 0) == 0);
+    REQUIRE_FALSE(std::getline(file, extra));
+    std::filesystem::remove(path);
+}
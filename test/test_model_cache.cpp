@@ -0,0 +1,67 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/model_cache.hpp"
+#include "mujoco/mujoco.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static void writeFile(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+TEST_CASE("Model cache key follows the XML, its includes and its assets", "[key]") {
+    fs::path root = fs::temp_directory_path() / "qmujocosim_test_model_cache_key";
+    fs::remove_all(root);
+    writeFile(root / "model.xml", R"(<mujoco>
+  <compiler meshdir="meshes"/>
+  <include file="parts.xml"/>
+</mujoco>)");
+    writeFile(root / "parts.xml", R"(<mujoco><asset><texture name="t" file="t.png"/></asset></mujoco>)");
+    writeFile(root / "meshes" / "t.png", "first");
+
+    std::string model = (root / "model.xml").string();
+    std::string key = ModelCache::computeKey(model);
+    REQUIRE(key.size() == 33);
+    REQUIRE(ModelCache::computeKey(model) == key);
+
+    // an asset of an included file, found through the including file's meshdir
+    writeFile(root / "meshes" / "t.png", "second");
+    REQUIRE(ModelCache::computeKey(model) != key);
+
+    // a missing asset disables caching
+    fs::remove(root / "meshes" / "t.png");
+    REQUIRE(ModelCache::computeKey(model).empty());
+
+    fs::remove_all(root);
+}
+
+TEST_CASE("Model cache serves the second load", "[load]") {
+    fs::path root = fs::temp_directory_path() / "qmujocosim_test_model_cache_load";
+    fs::remove_all(root);
+    writeFile(root / "model.xml", R"(<mujoco>
+  <worldbody>
+    <body><freejoint/><geom size="0.1"/></body>
+  </worldbody>
+</mujoco>)");
+
+    ModelCache cache((root / "cache").string(), 1 << 20);
+    std::string error;
+    bool hit = true;
+
+    mjModel *compiled = cache.load((root / "model.xml").string(), error, &hit);
+    REQUIRE(compiled != nullptr);
+    REQUIRE_FALSE(hit);
+
+    mjModel *cached = cache.load((root / "model.xml").string(), error, &hit);
+    REQUIRE(cached != nullptr);
+    REQUIRE(hit);
+    REQUIRE(cached->nq == compiled->nq);
+    REQUIRE(cached->ngeom == compiled->ngeom);
+
+    mj_deleteModel(compiled);
+    mj_deleteModel(cached);
+    fs::remove_all(root);
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/model_loader.hpp"
+#include "mujoco/mujoco.h"
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+#ifndef EXAMPLE_XML_PATH
+#define EXAMPLE_XML_PATH ""
+#endif
+
+TEST_CASE("The last of several load requests is not cancelled", "[loader]") {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<ModelLoader::Result> results;
+
+    uint64_t last = 0;
+    {
+        ModelLoader loader([&](ModelLoader::Result &&result) {
+            std::lock_guard<std::mutex> lockGuard(mtx);
+            results.push_back(std::move(result));
+            cv.notify_all();
+        });
+
+        // requests arrive both while the loader is idle and while it compiles
+        for (int i = 0; i < 20; i++) {
+            last = loader.load(EXAMPLE_XML_PATH);
+        }
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&]() { return !results.empty() && results.back().ticket == last; });
+    }
+
+    const ModelLoader::Result &result = results.back();
+    REQUIRE_FALSE(result.cancelled);
+    REQUIRE(result.model != nullptr);
+    REQUIRE(result.error.empty());
+
+    for (ModelLoader::Result &r : results) {
+        mj_deleteModel(r.model);
+    }
+}
+
+TEST_CASE("Cancelling a load reports the running request as cancelled", "[loader]") {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<ModelLoader::Result> results;
+
+    ModelLoader loader([&](ModelLoader::Result &&result) {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        results.push_back(std::move(result));
+        cv.notify_all();
+    });
+
+    uint64_t ticket = loader.load(EXAMPLE_XML_PATH);
+    loader.cancel();
+
+    // the request is either dropped before it starts, or reported as cancelled
+    while (loader.isBusy()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::lock_guard<std::mutex> lockGuard(mtx);
+    for (const ModelLoader::Result &r : results) {
+        REQUIRE(r.ticket == ticket);
+        REQUIRE(r.cancelled);
+        REQUIRE(r.model == nullptr);
+    }
+}
+
+TEST_CASE("A cached model's XML is parsed again for saving while its file is unchanged", "[save]") {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "qmujocosim_test_model_loader_save";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    std::string path = (root / "model.xml").string();
+    std::ofstream(path) << R"(<mujoco>
+  <worldbody>
+    <body><freejoint/><geom size="0.1"/></body>
+  </worldbody>
+</mujoco>)";
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<ModelLoader::Result> results;
+    std::optional<std::string> saveError;
+
+    ModelLoader loader([&](ModelLoader::Result &&result) {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        results.push_back(std::move(result));
+        cv.notify_all();
+    });
+    loader.setCache((root / "cache").string(), 1 << 20);
+    auto save = [&](const std::string &error) {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        saveError = error;
+        cv.notify_all();
+    };
+
+    // the second load is served from the cache
+    for (int i = 0; i < 2; i++) {
+        loader.load(path);
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&]() { return results.size() == static_cast<size_t>(i + 1); });
+    }
+    REQUIRE_FALSE(results[0].fromCache);
+    REQUIRE(results[1].fromCache);
+    REQUIRE_FALSE(results[1].cacheKey.empty());
+
+    loader.reparseForSave(path, results[1].cacheKey, save);
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&]() { return saveError.has_value(); });
+    }
+    REQUIRE(saveError->empty());
+
+    // an edited file no longer describes the cached model
+    std::ofstream(path, std::ios::app) << "<!-- edited -->";
+    saveError.reset();
+    loader.reparseForSave(path, results[1].cacheKey, save);
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&]() { return saveError.has_value(); });
+    }
+    REQUIRE_FALSE(saveError->empty());
+
+    for (ModelLoader::Result &r : results) {
+        mj_deleteModel(r.model);
+    }
+    fs::remove_all(root);
+}
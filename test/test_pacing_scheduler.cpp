@@ -0,0 +1,37 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/pacing_scheduler.hpp"
+
+TEST_CASE("Pacing scheduler never wakes up before the deadline", "[pacing]") {
+    PacingScheduler scheduler;
+    PacingScheduler::configureCurrentThread();
+
+    const int nwait = 20;
+    for (int i = 0; i < nwait; i++) {
+        // alternate sleeping and spinning waits of 2 ms, each from now, so a late wake-up cannot skip the next wait
+        auto deadline = PacingScheduler::Clock::now() + std::chrono::milliseconds(2);
+        REQUIRE(scheduler.wait(deadline, i % 2 == 1));
+        REQUIRE(PacingScheduler::Clock::now() >= deadline);
+    }
+
+    PacingStatistics stat = scheduler.statistics();
+    REQUIRE(stat.count == nwait);
+    REQUIRE(stat.maxJitter >= 0);
+    REQUIRE(stat.meanJitter <= stat.maxJitter);
+    REQUIRE(stat.rmsJitter <= stat.maxJitter);
+    REQUIRE(stat.late <= stat.count);
+}
+
+TEST_CASE("Pacing scheduler does not count deadlines already passed", "[pacing]") {
+    PacingScheduler scheduler;
+
+    REQUIRE_FALSE(scheduler.wait(PacingScheduler::Clock::now() - std::chrono::milliseconds(1), false));
+    REQUIRE(scheduler.statistics().count == 0);
+
+    scheduler.wait(PacingScheduler::Clock::now() + std::chrono::milliseconds(1), false);
+    REQUIRE(scheduler.statistics().count == 1);
+
+    // the reset is applied by the next wait, which is then the only one counted
+    scheduler.resetStatistics();
+    scheduler.wait(PacingScheduler::Clock::now() + std::chrono::milliseconds(1), true);
+    REQUIRE(scheduler.statistics().count == 1);
+}
@@ -0,0 +1,59 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "core/realtime_stats.hpp"
+
+using Catch::Matchers::WithinAbs;
+using Clock = RealtimeStats::Clock;
+using std::chrono::milliseconds;
+
+TEST_CASE("Real-time factor follows the recent window", "[factor]") {
+    RealtimeStats stats;
+    Clock::time_point wall = Clock::now();
+    double sim = 0;
+
+    // half real time for longer than the window, then real time for a whole window
+    for (int i = 0; i < 300; i++) {
+        stats.iteration(wall, sim);
+        wall += milliseconds(10);
+        sim += 0.005;
+    }
+    REQUIRE_THAT(stats.statistics().realtimeFactor, WithinAbs(0.5, 0.01));
+    for (int i = 0; i < 300; i++) {
+        stats.iteration(wall, sim);
+        wall += milliseconds(10);
+        sim += 0.010;
+    }
+    REQUIRE_THAT(stats.statistics().realtimeFactor, WithinAbs(1.0, 0.01));
+
+    // a reset restarts the window instead of producing a negative factor
+    stats.iteration(wall, 0);
+    REQUIRE(stats.statistics().realtimeFactor > 0);
+}
+
+TEST_CASE("Stalls, misses and resyncs are counted while running", "[events]") {
+    RealtimeStats stats;
+    Clock::time_point wall = Clock::now();
+
+    stats.iteration(wall, 0);
+    stats.finished(wall + milliseconds(2), wall);
+    wall += milliseconds(300);
+    stats.iteration(wall, 0.002);
+    stats.resync();
+    stats.finished(wall - milliseconds(5), wall);
+
+    // the time spent paused is not a stall
+    stats.paused();
+    wall += milliseconds(5000);
+    stats.iteration(wall, 0.004);
+
+    RealtimeStatistics stat = stats.statistics();
+    REQUIRE(stat.iterations == 3);
+    REQUIRE(stat.resyncs == 1);
+    REQUIRE(stat.deadlineMisses == 1);
+    REQUIRE_THAT(stat.longestStall, WithinAbs(0.3, 1e-6));
+
+    stats.resetStatistics();
+    stats.iteration(wall, 0.006);
+    REQUIRE(stats.statistics().iterations == 1);
+    REQUIRE(stats.statistics().longestStall == 0);
+}
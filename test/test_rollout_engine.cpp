@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/rollout_engine.hpp"
+#include "mujoco/mujoco.h"
+
+#include <vector>
+#include <algorithm>
+
+#ifndef EXAMPLE_XML_PATH
+#define EXAMPLE_XML_PATH ""
+#endif
+
+TEST_CASE("Rollout engine matches serial stepping", "[rollout]") {
+    char error[1000];
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+
+    constexpr int nrollout = 37;
+    constexpr int nstep = 50;
+
+    RolloutEngine engine(m, 4);
+    int ns = engine.stateSize();
+
+    // initial states: default pose with a different velocity on the free body
+    mjData *d = mj_makeData(m);
+    std::vector<mjtNum> initialStates(nrollout * ns);
+    for (int r = 0; r < nrollout; r++) {
+        mj_resetData(m, d);
+        d->qvel[m->nv - 1] = 0.1 * r;
+        mj_getState(m, d, &initialStates[r * ns], mjSTATE_INTEGRATION);
+    }
+
+    std::vector<mjtNum> states = engine.rollout(initialStates, nstep);
+    REQUIRE(states.size() == static_cast<size_t>(nrollout) * nstep * ns);
+
+    std::vector<mjtNum> expected(ns);
+    for (int r = 0; r < nrollout; r++) {
+        mj_resetData(m, d);
+        mj_setState(m, d, &initialStates[r * ns], mjSTATE_INTEGRATION);
+        for (int t = 0; t < nstep; t++) {
+            mj_step(m, d);
+        }
+        mj_getState(m, d, expected.data(), mjSTATE_INTEGRATION);
+
+        const mjtNum *last = &states[(static_cast<size_t>(r) * nstep + nstep - 1) * ns];
+        for (int i = 0; i < ns; i++) {
+            REQUIRE(last[i] == expected[i]);
+        }
+    }
+
+    mj_deleteData(d);
+    mj_deleteModel(m);
+}
+
+TEST_CASE("Rollout engine gives the same results over many short calls", "[rollout]") {
+    char error[1000];
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+
+    RolloutEngine engine(m, 4);
+    int ns = engine.stateSize();
+
+    mjData *d = mj_makeData(m);
+    std::vector<mjtNum> initialStates(8 * ns);
+    for (int r = 0; r < 8; r++) {
+        mj_resetData(m, d);
+        d->qvel[m->nv - 1] = 0.1 * r;
+        mj_getState(m, d, &initialStates[r * ns], mjSTATE_INTEGRATION);
+    }
+    std::vector<mjtNum> reference = engine.rollout(initialStates, 5);
+
+    // the workers are reused, also by calls with fewer rollouts than threads
+    for (int call = 0; call < 200; call++) {
+        int nrollout = 1 + call % 8;
+        std::vector<mjtNum> batch(initialStates.begin(), initialStates.begin() + nrollout * ns);
+        std::vector<mjtNum> states = engine.rollout(batch, 5);
+        REQUIRE(std::equal(states.begin(), states.end(), reference.begin()));
+    }
+
+    mj_deleteData(d);
+    mj_deleteModel(m);
+}
@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/scrub_service.hpp"
+#include "mujoco/mujoco.h"
+
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef EXAMPLE_XML_PATH
+#define EXAMPLE_XML_PATH ""
+#endif
+
+// a scrub job that blocks its first run until released, recording every request it runs and whether it was cancelled
+struct BlockingJob {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool started = false;
+    bool released = false;
+    std::vector<int> runs;
+    bool firstCancelled = false;
+
+    void operator()(int request, const std::function<bool()> &cancelled) {
+        std::unique_lock<std::mutex> lock(mtx);
+        bool first = runs.empty();
+        runs.push_back(request);
+        if (first) {
+            started = true;
+            cv.notify_all();
+            cv.wait(lock, [this]() { return released; });
+            firstCancelled = cancelled();
+        }
+    }
+
+    void waitStarted() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]() { return started; });
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lockGuard(mtx);
+        released = true;
+        cv.notify_all();
+    }
+};
+
+TEST_CASE("Scrub requests are coalesced, latest wins", "[scrub]") {
+    BlockingJob job;
+    ScrubService service([&](int request, const std::function<bool()> &cancelled) { job(request, cancelled); });
+
+    service.request(1);
+    job.waitStarted();
+
+    // arrive while the first job runs: only the newest is run, and the running job is told to stop
+    service.request(2);
+    service.request(3);
+    service.request(4);
+    job.release();
+    service.wait();
+
+    REQUIRE(job.firstCancelled);
+    REQUIRE(job.runs == std::vector<int>{1, 4});
+}
+
+TEST_CASE("Cancelling a scrub drops the pending request", "[scrub]") {
+    BlockingJob job;
+    ScrubService service([&](int request, const std::function<bool()> &cancelled) { job(request, cancelled); });
+
+    service.request(1);
+    job.waitStarted();
+    service.request(2);
+    service.cancel();
+    job.release();
+    service.wait();
+
+    REQUIRE(job.firstCancelled);
+    REQUIRE(job.runs == std::vector<int>{1});
+
+    // the service keeps serving requests after a cancellation
+    service.request(5);
+    service.wait();
+    REQUIRE(job.runs == std::vector<int>{1, 5});
+}
+
+TEST_CASE("A request to an idle service runs to completion", "[scrub]") {
+    std::vector<std::pair<int, bool>> runs;   // request, whether it was cancelled when it finished
+    ScrubService service([&](int request, const std::function<bool()> &cancelled) {
+        runs.emplace_back(request, cancelled());
+    });
+
+    // each request reaches an idle worker, so none of them may see itself cancelled
+    for (int i = 0; i < 1000; i++) {
+        service.request(i);
+        service.wait();
+        REQUIRE(runs.back() == std::make_pair(i, false));
+    }
+    REQUIRE(runs.size() == 1000);
+}
+
+TEST_CASE("Forward cache evicts the least recently used frame", "[cache]") {
+    char error[1000];
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+    mjData *d = mj_makeData(m);
+
+    ForwardCache cache;
+    for (int frame = 0; frame < ForwardCache::kCapacity; frame++) {
+        d->time = frame;
+        const mjData *cached = cache.insert(frame, m, d);
+        REQUIRE(cached != d);
+        REQUIRE(cached->time == frame);
+    }
+
+    // use every frame again, frame 0 first, so it is the least recently used one
+    for (int frame = 0; frame < ForwardCache::kCapacity; frame++) {
+        REQUIRE(cache.find(frame) != nullptr);
+    }
+    d->time = 100;
+    cache.insert(100, m, d);
+    REQUIRE(cache.find(0) == nullptr);
+    REQUIRE(cache.find(100)->time == 100);
+    REQUIRE(cache.find(1) != nullptr);
+
+    cache.clear();
+    REQUIRE(cache.find(100) == nullptr);
+
+    mj_deleteData(d);
+    mj_deleteModel(m);
+}
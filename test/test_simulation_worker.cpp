@@ -2,6 +2,8 @@
 #include "core/simulation_worker.hpp"
 #include "mujoco/mujoco.h"
 
+#include <cmath>
+
 #ifndef EXAMPLE_XML_PATH
 #define EXAMPLE_XML_PATH ""
 #endif
@@ -35,4 +37,73 @@ TEST_CASE("Simulation worker", "[basic]") {
         simulationThread.join();
     }
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("Simulation worker records every step of a batch", "[history]") {
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+    double timestep = m->opt.timestep;
+
+    SimulationWorker simulationWorker(nullptr, nullptr);
+    simulationWorker.replace(m);
+
+    // far faster than real time, so loop iterations step several times
+    simulationWorker.setSlowdown(0.01);
+    std::thread simulationThread([&]() { simulationWorker.startSimulationLoop(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    simulationWorker.setSimulationPaused(true);
+
+    long long nstep = 0;
+    simulationWorker.accessModelAndData([&](mjModel *, mjData *d) {
+        nstep = std::llround(d->time / timestep);
+    });
+    REQUIRE(simulationWorker.getRealtimeStatistics().iterations < nstep);
+
+    // one frame per step, plus the initial state
+    REQUIRE(simulationWorker.getHistoryBufferAvailable() == nstep + 1);
+
+    // scrubbed frames are as far back in simulation time as they are in frames
+    int back = static_cast<int>(std::min<long long>(nstep, 100));
+    simulationWorker.setScrubIndex(-back);
+    double scrubbed = -1;
+    for (int attempt = 0; attempt < 200; attempt++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        simulationWorker.accessModelAndData([&](mjModel *, mjData *d) { scrubbed = d->time; });
+        if (std::llround(scrubbed / timestep) != nstep) {
+            break;
+        }
+    }
+    REQUIRE(std::llround(scrubbed / timestep) == nstep - back);
+
+    simulationWorker.terminateSimulation();
+    simulationThread.join();
+}
+
+
+TEST_CASE("Simulation worker does not count pauses as resyncs", "[realtime]") {
+    mjModel *m = mj_loadXML(EXAMPLE_XML_PATH, nullptr, error, 1000);
+    REQUIRE(m != nullptr);
+
+    // at half speed the model keeps up easily, so the simulation never drifts by itself
+    SimulationWorker simulationWorker(nullptr, nullptr);
+    simulationWorker.replace(m);
+    simulationWorker.setSlowdown(2);
+    std::thread simulationThread([&]() { simulationWorker.startSimulationLoop(); });
+
+    // each pause is longer than `syncMisalign` in simulation time
+    constexpr int npause = 3;
+    for (int i = 0; i < npause; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        simulationWorker.setSimulationPaused(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        simulationWorker.setSimulationPaused(false);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    RealtimeStatistics stat = simulationWorker.getRealtimeStatistics();
+    REQUIRE(stat.iterations > 0);
+    REQUIRE(stat.resyncs == 0);
+
+    simulationWorker.terminateSimulation();
+    simulationThread.join();
+}
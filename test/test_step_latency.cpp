@@ -0,0 +1,59 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "core/step_latency.hpp"
+
+#include <memory>
+
+using Catch::Matchers::WithinAbs;
+
+// advance the step timer of `d` by `msec`, as one mj_step would
+static void fakeStep(StepLatency &latency, mjData *d, double msec) {
+    StepLatency::Sample before = StepLatency::timers(d);
+    d->timer[mjTIMER_STEP].duration += msec;
+    d->timer[mjTIMER_STEP].number++;
+    d->timer[mjTIMER_POS_COLLISION].duration += msec / 4;
+    latency.record(StepLatency::since(before, d));
+}
+
+TEST_CASE("Step latency percentiles see the outliers", "[basic]") {
+    auto d = std::make_unique<mjData>();
+    StepLatency latency(100);
+
+    for (int i = 0; i < 99; i++) {
+        fakeStep(latency, d.get(), 1.0);
+    }
+    fakeStep(latency, d.get(), 50.0);
+    REQUIRE(latency.collect() == 100);
+
+    StepLatency::Percentiles total = latency.percentiles();
+    REQUIRE_THAT(total.p50, WithinAbs(1.0, 1e-4));
+    REQUIRE_THAT(total.p99, WithinAbs(1.0, 1e-4));
+    REQUIRE_THAT(total.max, WithinAbs(50.0, 1e-4));
+    REQUIRE_THAT(latency.percentiles(StepLatency::COLLISION).max, WithinAbs(12.5, 1e-4));
+
+    std::vector<int> histogram = latency.histogram(StepLatency::TOTAL, 10, 0.5f);
+    REQUIRE(histogram[2] == 99);
+    REQUIRE(histogram[9] == 1);
+}
+
+TEST_CASE("Step latency window rolls and counts dropped steps", "[basic]") {
+    auto d = std::make_unique<mjData>();
+    StepLatency latency(10, 16);
+
+    for (int i = 0; i < 20; i++) {
+        fakeStep(latency, d.get(), 5.0);
+    }
+    REQUIRE(latency.dropped() == 4);
+    REQUIRE(latency.collect() == 16);
+    REQUIRE(latency.size() == 10);
+
+    for (int i = 0; i < 10; i++) {
+        fakeStep(latency, d.get(), 2.0);
+    }
+    latency.collect();
+    REQUIRE_THAT(latency.percentiles().max, WithinAbs(2.0, 1e-4));
+
+    latency.clearWindow();
+    REQUIRE(latency.size() == 0);
+    REQUIRE(latency.percentiles().max == 0);
+}
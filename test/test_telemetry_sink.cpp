@@ -0,0 +1,73 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/telemetry_sink.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::vector<fs::path> listFiles(const fs::path &directory) {
+    std::vector<fs::path> files;
+    for (const auto &entry: fs::directory_iterator(directory)) {
+        files.push_back(entry.path());
+    }
+    return files;
+}
+
+TEST_CASE("Telemetry writes one CSV line per step", "[csv]") {
+    fs::path root = fs::temp_directory_path() / "qmujocosim_test_telemetry_csv";
+    fs::remove_all(root);
+    fs::create_directories(root);
+
+    auto d = std::make_unique<mjData>();
+    TelemetrySink sink;
+    REQUIRE(sink.open(root.string(), TelemetrySink::CSV, 0));
+    StepLatency::Sample timers = {2.0f, 0.5f, 0.25f, 0.25f, 1.0f};
+    for (int i = 0; i < 100; i++) {
+        d->time = 0.002 * i;
+        sink.record(d.get(), timers);
+    }
+    sink.close();
+    REQUIRE(sink.written() == 100);
+    REQUIRE(sink.dropped() == 0);
+
+    std::vector<fs::path> files = listFiles(root);
+    REQUIRE(files.size() == 1);
+    std::ifstream file(files[0]);
+    std::string line;
+    std::getline(file, line);
+    REQUIRE(line == "step,time,nisland,niter,nefc,ncon,nnz,total,collision,make,project,constraint");
+    int lines = 0;
+    while (std::getline(file, line)) {
+        lines++;
+    }
+    REQUIRE(lines == 100);
+
+    fs::remove_all(root);
+}
+
+TEST_CASE("Telemetry rotates binary files and keeps the newest", "[binary]") {
+    fs::path root = fs::temp_directory_path() / "qmujocosim_test_telemetry_binary";
+    fs::remove_all(root);
+    fs::create_directories(root);
+
+    auto d = std::make_unique<mjData>();
+    TelemetrySink sink;
+    // 12 byte header plus 10 records per file
+    REQUIRE(sink.open(root.string(), TelemetrySink::BINARY, 12 + 10 * TelemetrySink::BINARY_RECORD_SIZE, 3));
+    for (int i = 0; i < 100; i++) {
+        sink.record(d.get(), {});
+    }
+    sink.close();
+    REQUIRE(sink.written() == 100);
+
+    std::vector<fs::path> files = listFiles(root);
+    REQUIRE(files.size() == 3);
+    for (const auto &path: files) {
+        REQUIRE(fs::file_size(path) == 12 + 10 * TelemetrySink::BINARY_RECORD_SIZE);
+    }
+
+    fs::remove_all(root);
+}
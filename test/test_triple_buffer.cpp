@@ -0,0 +1,47 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/triple_buffer.hpp"
+
+#include <thread>
+
+TEST_CASE("Triple buffer hands over the latest value", "[basic]") {
+    TripleBuffer<int> buffer;
+
+    REQUIRE_FALSE(buffer.update());
+
+    buffer.writeBuffer() = 1;
+    buffer.publish();
+    buffer.writeBuffer() = 2;
+    buffer.publish();
+
+    REQUIRE(buffer.update());
+    REQUIRE(buffer.readBuffer() == 2);
+    REQUIRE_FALSE(buffer.update());
+    REQUIRE(buffer.readBuffer() == 2);
+}
+
+TEST_CASE("Triple buffer never tears under concurrency", "[concurrency]") {
+    struct Pair {
+        long a = 0;
+        long b = 0;
+    };
+    TripleBuffer<Pair> buffer;
+    constexpr long n = 200000;
+
+    std::thread producer([&]() {
+        for (long i = 1; i <= n; i++) {
+            buffer.writeBuffer() = {i, -i};
+            buffer.publish();
+        }
+    });
+
+    long last = 0;
+    while (last < n) {
+        if (buffer.update()) {
+            const Pair &p = buffer.readBuffer();
+            REQUIRE(p.a == -p.b);
+            REQUIRE(p.a > last);
+            last = p.a;
+        }
+    }
+    producer.join();
+}